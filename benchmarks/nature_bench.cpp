@@ -0,0 +1,260 @@
+// Microbenchmarks for the CPU hot paths: terrain noise, chunk and water mesh building, and
+// the particle simulation. No Qt or GL, so it runs anywhere the simulation code compiles.
+//
+//   nature_bench [--filter <substring>] [--min-time <ms>] [--output <file>]
+//
+// Results are written as JSON (to stdout without --output), one entry per benchmark and
+// size, with fields that stay stable so runs can be diffed over time:
+//
+// { "schema": 1, "minTimeMs": 200, "benchmarks": [
+//   { "name": "computePerlin", "size": 4096, "iterations": 812, "nsPerOp": 5.1,
+//     "itemsPerSecond": 1.9e8, "allocationsPerOp": 0, "bytesAllocatedPerOp": 0 }, ... ] }
+//
+// An op is one call of the measured function (one sample, one chunk, one update). Each
+// benchmark runs in batches until a batch takes at least --min-time, three times, and
+// reports the fastest batch. Allocations are counted by replacing global operator new.
+
+#include "utils/terrain.h"
+#include "utils/particle.h"
+#include "utils/heightGrid.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    size_t size;
+    uint64_t iterations;
+    double nsPerOp;
+    double itemsPerSecond;
+    double allocationsPerOp;
+    double bytesAllocatedPerOp;
+};
+
+struct Options {
+    std::string filter;
+    std::string output;
+    double minTimeMs = 200.0;
+};
+
+// Keeps results alive so the measured calls are not optimized away
+volatile float g_sink;
+
+// op(n) performs n ops; itemsPerOp scales ns/op into items/s (vertices, particles, ...).
+// Skipped unless the name contains the --filter substring.
+void measure(const Options& options, std::vector<Result>& results, const std::string& name, size_t size,
+             double itemsPerOp, const std::function<void(uint64_t)>& op) {
+    if (name.find(options.filter) == std::string::npos) return;
+    op(1);  // Warm caches and lazily grown buffers
+
+    Result best{name, size, 0, 0.0, 0.0, 0.0, 0.0};
+    for (int repeat = 0; repeat < 3; repeat++) {
+        uint64_t iterations = 1;
+        while (true) {
+            uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+            uint64_t bytes = g_allocatedBytes.load(std::memory_order_relaxed);
+            auto start = Clock::now();
+            op(iterations);
+            double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+            bytes = g_allocatedBytes.load(std::memory_order_relaxed) - bytes;
+
+            if (ns >= options.minTimeMs * 1e6 || iterations >= (1ull << 40)) {
+                double nsPerOp = ns / iterations;
+                if (best.iterations == 0 || nsPerOp < best.nsPerOp) {
+                    best.iterations = iterations;
+                    best.nsPerOp = nsPerOp;
+                    best.itemsPerSecond = nsPerOp > 0.0 ? itemsPerOp * 1e9 / nsPerOp : 0.0;
+                    best.allocationsPerOp = double(allocations) / iterations;
+                    best.bytesAllocatedPerOp = double(bytes) / iterations;
+                }
+                break;
+            }
+            // Aim straight for the target instead of doubling all the way there
+            double scale = ns > 0.0 ? options.minTimeMs * 1e6 * 1.2 / ns : 10.0;
+            iterations = std::max<uint64_t>(iterations * 2, uint64_t(iterations * std::min(scale, 100.0)));
+        }
+    }
+    fprintf(stderr, "%-40s %8zu %12.1f ns/op\n", name.c_str(), size, best.nsPerOp);
+    results.push_back(best);
+}
+
+// Sample coordinates in normalized terrain space, spread over several noise cells
+std::vector<glm::vec2> samplePoints(size_t count, float extent) {
+    std::vector<glm::vec2> points(count);
+    Pcg32 rng(42);
+    for (glm::vec2& point : points) {
+        point = glm::vec2(rng.nextFloat(-extent, extent), rng.nextFloat(-extent, extent));
+    }
+    return points;
+}
+
+void benchmarkNoise(const Options& options, std::vector<Result>& results) {
+    TerrainGenerator terrain;
+    for (size_t size : {size_t(256), size_t(4096), size_t(65536)}) {
+        // Working sets from L1-resident to larger than L2
+        std::vector<glm::vec2> local = samplePoints(size, 8.0f);
+        std::vector<glm::vec2> world = samplePoints(size, 2000.0f);
+
+        auto sweep = [&](const std::vector<glm::vec2>& points, auto&& sample) {
+            return [&, sample](uint64_t n) {
+                float sum = 0.0f;
+                for (uint64_t i = 0; i < n; i++) {
+                    const glm::vec2& p = points[i % points.size()];
+                    sum += sample(p);
+                }
+                g_sink = sum;
+            };
+        };
+        measure(options, results, "computePerlin", size, 1.0,
+            sweep(local, [&](const glm::vec2& p) { return terrain.computePerlin(p.x, p.y); }));
+        measure(options, results, "getHeight", size, 1.0,
+            sweep(local, [&](const glm::vec2& p) { return terrain.getHeight(p.x, p.y); }));
+        measure(options, results, "getWorldHeight", size, 1.0,
+            sweep(world, [&](const glm::vec2& p) { return terrain.getWorldHeight(p.x, p.y); }));
+    }
+}
+
+void benchmarkMeshes(const Options& options, std::vector<Result>& results) {
+    TerrainGenerator terrain;
+    int verticesPerSide = static_cast<int>(TerrainGenerator::CHUNK_SIZE / TerrainGenerator::VERTEX_SPACING);
+    double verticesPerMesh = double(verticesPerSide) * verticesPerSide * 6;
+
+    // Mesh cost does not depend on where the chunk is, so there is no size axis; chunks
+    // still cycle through a 16x16 area to keep the work realistic. An op is one mesh.
+    const int side = 16;
+    measure(options, results, "generateTerrainChunk", 1, verticesPerMesh,
+        [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                int chunk = static_cast<int>(i % (side * side));
+                std::vector<float> verts = terrain.generateTerrainChunk(chunk % side, chunk / side);
+                g_sink = verts.back();
+            }
+        });
+    measure(options, results, "generateWaterPlane", 1, verticesPerMesh,
+        [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                int chunk = static_cast<int>(i % (side * side));
+                glm::dvec2 position(double(chunk % side) * TerrainGenerator::CHUNK_SIZE,
+                                    double(chunk / side) * TerrainGenerator::CHUNK_SIZE);
+                std::vector<float> verts = TerrainGenerator::generateWaterPlane(position);
+                g_sink = verts.back();
+            }
+        });
+}
+
+void benchmarkParticles(const Options& options, std::vector<Result>& results) {
+    TerrainGenerator terrain;
+    HeightGrid grid;
+    grid.recenter(terrain, 0.0f, 0.0f);
+    const float deltaTime = 1.0f / 60.0f;
+
+    for (int size : {1000, 10000, 100000}) {
+        for (bool snow : {true, false}) {
+            for (bool ground : {false, true}) {
+                ParticleSystem particles(size);
+                particles.seed(1);
+                particles.setParticleType(snow);
+                particles.setWindDirection(glm::vec3(1.0f, 0.0f, 0.5f));
+                particles.setViewDirection(glm::vec3(0.0f, 0.0f, -1.0f));
+                if (ground) particles.setGround(&grid);
+                particles.reset();
+
+                std::string name = std::string("ParticleSystem::update/") + (snow ? "snow" : "rain") +
+                                   (ground ? "/heightGrid" : "/flat");
+                measure(options, results, name, size, size, [&](uint64_t n) {
+                    for (uint64_t i = 0; i < n; i++) particles.update(deltaTime);
+                    g_sink = particles.getParticles().front().position.y;
+                });
+            }
+        }
+    }
+}
+
+void writeJson(FILE* out, const Options& options, const std::vector<Result>& results) {
+    fprintf(out, "{\n  \"schema\": 1,\n  \"minTimeMs\": %g,\n  \"benchmarks\": [\n", options.minTimeMs);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"size\": %zu, \"iterations\": %llu, \"nsPerOp\": %.3f, "
+                "\"itemsPerSecond\": %.6g, \"allocationsPerOp\": %.3f, \"bytesAllocatedPerOp\": %.1f}%s\n",
+                r.name.c_str(), r.size, static_cast<unsigned long long>(r.iterations), r.nsPerOp,
+                r.itemsPerSecond, r.allocationsPerOp, r.bytesAllocatedPerOp,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--filter") && hasValue) options.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--output") && hasValue) options.output = argv[++i];
+        else if (!std::strcmp(argv[i], "--min-time") && hasValue) options.minTimeMs = std::atof(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--filter <substring>] [--min-time <ms>] [--output <file>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    benchmarkNoise(options, results);
+    benchmarkMeshes(options, results);
+    benchmarkParticles(options, results);
+
+    FILE* out = options.output.empty() ? stdout : fopen(options.output.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Failed to write %s\n", options.output.c_str());
+        return 1;
+    }
+    writeJson(out, options, results);
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,5 @@
+#version 330 core
+
+// Depth-only pass: the depth test does all the work, no color is written
+void main() {
+}
@@ -1,16 +1,43 @@
 // resources/shaders/particle.vert
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in float aSize;
-layout (location = 2) in float aLife;
+layout (location = 1) in vec2 aSizeLife;  // x = size, y = life
 
-uniform mat4 projection;
-uniform mat4 view;
+// Per-frame data shared by every program, see UniformManager::FrameData
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 sunDirection;
+    float brightness;
+    float time;
+};
+
+uniform bool distanceLod;   // Thin out distant particles, as ParticleSystem::writeVertices
+uniform vec3 lodParams;     // near, far, kept fraction at far
+uniform float pointScale;   // Render resolution relative to the window
 
 out float life;
 
+uint pcgHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
 void main() {
-    life = aLife;
-    gl_Position = projection * view * vec4(aPos, 1.0);
-    gl_PointSize = aSize * (1.0 / gl_Position.w) * 1000.0;  // Scale with distance
+    life = aSizeLife.y;
+    if (distanceLod) {
+        float t = clamp((distance(aPos, cameraPosition.xyz) - lodParams.x) / (lodParams.y - lodParams.x), 0.0, 1.0);
+        float keep = 1.0 - t * (1.0 - lodParams.z);
+        if (float(pcgHash(uint(gl_VertexID)) >> 8) / 16777216.0 > keep) {
+            // Outside the clip volume, so the point is dropped before rasterization
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+            gl_PointSize = 0.0;
+            return;
+        }
+    }
+    gl_Position = viewProjection * vec4(aPos, 1.0);
+    gl_PointSize = aSizeLife.x * (1.0 / gl_Position.w) * 1000.0 * pointScale;  // Scale with distance
 }
@@ -0,0 +1,104 @@
+// resources/shaders/particle_update.vert
+#version 330 core
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inVelocity;
+layout (location = 2) in float inSize;
+layout (location = 3) in float inLife;
+
+// Captured with transform feedback, interleaved in this order
+out vec3 outPosition;
+out vec3 outVelocity;
+out float outSize;
+out float outLife;
+
+uniform float deltaTime;
+uniform bool isSnow;
+uniform vec3 windDirection;
+uniform vec2 emissionArea;
+uniform vec3 anchor;        // Volume centre, follows the camera
+uniform float particleSpeed;
+uniform float groundLevel;     // Used when no terrain grid is bound
+uniform sampler2D heightGrid;  // HeightGrid samples, texel (0, 0) at heightGridOrigin
+uniform vec2 heightGridOrigin;
+uniform float heightGridSpacing;
+uniform float heightGridResolution;
+uniform bool useHeightGrid;
+uniform float spawnHeight;
+uniform uint frameSeed;
+uniform vec2 viewDirection;     // Horizontal camera forward, unit length or zero
+uniform float emissionViewBias;
+
+// PCG hash, one stream per particle per frame
+uint pcgHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float randomFloat(inout uint state, float minValue, float maxValue) {
+    state = pcgHash(state);
+    return mix(minValue, maxValue, float(state) / 4294967295.0);
+}
+
+// Bilinear terrain height, as HeightGrid::sample; texel centres sit on the samples
+float groundHeight(vec2 xz) {
+    if (!useHeightGrid) return groundLevel;
+    vec2 uv = ((xz - heightGridOrigin) / heightGridSpacing + 0.5) / heightGridResolution;
+    return textureLod(heightGrid, uv, 0.0).r;
+}
+
+// Mirrors ParticleSystem::resetParticle(particle, true)
+void respawn(inout uint state) {
+    vec2 offset;
+    offset.x = randomFloat(state, -emissionArea.x / 2.0, emissionArea.x / 2.0);
+    float height = randomFloat(state, 0.0, spawnHeight);
+    offset.y = randomFloat(state, -emissionArea.y / 2.0, emissionArea.y / 2.0);
+    // Mirror most spawns behind the camera to the front
+    float along = dot(offset, viewDirection);
+    if (along < 0.0 && randomFloat(state, 0.0, 1.0) < emissionViewBias) {
+        offset -= 2.0 * along * viewDirection;
+    }
+    offset -= emissionArea * floor(offset / emissionArea + 0.5);
+    outPosition.xz = anchor.xz + offset;
+    outPosition.y = (useHeightGrid ? groundHeight(outPosition.xz) : 0.0) + height;
+
+    if (isSnow) {
+        outVelocity = vec3(randomFloat(state, -0.5, 0.5),
+                           -particleSpeed * 0.15,
+                           randomFloat(state, -0.5, 0.5));
+        outSize = 0.3;
+        outLife = 1.0;
+    } else {
+        outVelocity = vec3(randomFloat(state, -0.1, 0.1),
+                           -particleSpeed * 2.0,
+                           randomFloat(state, -0.1, 0.1));
+        outSize = 0.08;
+        outLife = randomFloat(state, 0.7, 1.0);
+    }
+}
+
+void main() {
+    outVelocity = inVelocity;
+    outPosition = inPosition;
+    outSize = inSize;
+    outLife = inLife;
+
+    if (isSnow) {
+        float swayX = sin(inPosition.y * 0.05 + inLife * 2.0) * 0.3;
+        float swayZ = cos(inPosition.y * 0.05 + inLife * 2.0) * 0.3;
+        outVelocity += windDirection * (deltaTime * 0.5);
+        outPosition += outVelocity * deltaTime;
+        outPosition += vec3(swayX, 0.0, swayZ) * deltaTime;
+    } else {
+        outPosition += outVelocity * deltaTime;
+    }
+
+    // Toroidal wrap around the anchor, as in ParticleSystem::wrapToVolume
+    vec2 offset = outPosition.xz - anchor.xz;
+    outPosition.xz = anchor.xz + offset - emissionArea * floor(offset / emissionArea + 0.5);
+
+    if (outPosition.y < groundHeight(outPosition.xz)) {
+        uint state = pcgHash(uint(gl_VertexID) ^ pcgHash(frameSeed));
+        respawn(state);
+    }
+}
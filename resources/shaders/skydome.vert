@@ -3,11 +3,20 @@
 layout(location = 0) in vec3 position;
 out vec3 worldPos;
 
+// Per-frame data shared by every program, see UniformManager::FrameData
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 sunDirection;
+    float brightness;
+    float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main() {
     worldPos = position;
-    gl_Position = projection * view * model * vec4(position, 1.0);
+    gl_Position = viewProjection * model * vec4(position, 1.0);
 }
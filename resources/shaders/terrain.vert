@@ -10,20 +10,33 @@ out vec2 fragUV;    // Pass UV coordinates to fragment shader
 out float height;   // Pass normalized height to fragment shader
 out vec3 fragNormal; // Pass world-space normal to fragment shader
 
-uniform mat4 projection;
+// Per-frame data shared by every program, see UniformManager::FrameData
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 sunDirection;
+    float brightness;
+    float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
+uniform mat3 normalMatrix;  // transpose(inverse(mat3(model))), computed on the CPU
+
+// The depth prepass reuses this shader; depths must match bit for bit across both programs
+invariant gl_Position;
 
 void main() {
     // Transform vertex position to clip space
-    gl_Position = projection * view * model * vec4(position, 1.0);
+    vec4 worldPosition = model * vec4(position, 1.0);
+    gl_Position = viewProjection * worldPosition;
 
     // Calculate normalized height in world space (assuming y is the height axis)
-    vec4 worldPosition = model * vec4(position, 1.0);
     height = worldPosition.y;  // Use actual y-coordinate for height
 
     // Pass other attributes to fragment shader
     outColor = color;
     fragUV = uv;
-    fragNormal = mat3(transpose(inverse(model))) * normal; // Transform normal to world space
+    fragNormal = normalMatrix * normal; // Transform normal to world space
 }
@@ -0,0 +1,31 @@
+#version 330 core
+
+// Stretches the dynamic-resolution scene over the window and restores some of the detail
+// lost to the lower resolution with a 5-tap unsharp mask, clamped to the local range so
+// edges do not ring
+in vec2 uv;
+out vec4 fragColor;
+
+uniform sampler2D scene;
+uniform vec2 uvScale;     // Fraction of the texture the scene was drawn into
+uniform vec2 texelSize;   // 1 / texture size
+uniform float sharpness;  // 0 is plain bilinear
+
+vec3 sampleScene(vec2 p) {
+    // Never filter in texels outside the drawn region
+    return texture(scene, clamp(p, 0.5 * texelSize, uvScale - 0.5 * texelSize)).rgb;
+}
+
+void main() {
+    vec2 p = uv * uvScale;
+    vec3 center = sampleScene(p);
+    vec3 north = sampleScene(p + vec2(0.0, texelSize.y));
+    vec3 south = sampleScene(p - vec2(0.0, texelSize.y));
+    vec3 east = sampleScene(p + vec2(texelSize.x, 0.0));
+    vec3 west = sampleScene(p - vec2(texelSize.x, 0.0));
+
+    vec3 blur = 0.25 * (north + south + east + west);
+    vec3 low = min(center, min(min(north, south), min(east, west)));
+    vec3 high = max(center, max(max(north, south), max(east, west)));
+    fragColor = vec4(clamp(center + sharpness * (center - blur), low, high), 1.0);
+}
@@ -6,11 +6,20 @@ in vec2 DispCoord1;
 in vec2 DispCoord2;
 in vec2 WaveCoord;
 
+// Per-frame data shared by every program, see UniformManager::FrameData
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 sunDirection;
+    float brightness;
+    float time;
+};
+
 uniform sampler2D dispTexture;
 uniform float dispStrength;
-uniform float time;
 uniform float alpha;
-uniform float brightness;
 uniform float minBrightness;
 
 float processWaterLayer(vec2 coord) {
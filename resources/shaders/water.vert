@@ -2,10 +2,18 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
 
+// Per-frame data shared by every program, see UniformManager::FrameData
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 sunDirection;
+    float brightness;
+    float time;
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform float time;
 
 out vec2 TexCoord;
 out vec2 DispCoord1;
@@ -13,7 +21,7 @@ out vec2 DispCoord2;
 out vec2 WaveCoord;
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
 
     // Calculate texture coordinates with time-based animation
     TexCoord = aTexCoord;
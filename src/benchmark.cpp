@@ -0,0 +1,248 @@
+#include "benchmark.h"
+#include "glrenderer.h"
+#include "settings.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+glm::vec3 toVec3(const QJsonValue& value, const glm::vec3& fallback) {
+    QJsonArray array = value.toArray();
+    if (array.size() != 3) return fallback;
+    return glm::vec3(array[0].toDouble(), array[1].toDouble(), array[2].toDouble());
+}
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    double rank = std::ceil(p / 100.0 * sorted.size());
+    size_t index = rank > 1.0 ? static_cast<size_t>(rank) - 1 : 0;
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Peak resident set size of the process, 0 where unsupported
+long long peakRssBytes() {
+#if defined(__APPLE__)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;           // Bytes
+#elif defined(__unix__)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss * 1024LL : 0;  // Kilobytes
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+Benchmark::Benchmark(const QString& scriptPath, int frames, const QString& outputPath)
+    : m_scriptPath(scriptPath)
+    , m_outputPath(outputPath)
+    , m_frames(frames) {
+}
+
+bool Benchmark::loadScript() {
+    QFile file(m_scriptPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Failed to open benchmark script " << m_scriptPath.toStdString() << std::endl;
+        return false;
+    }
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject()) {
+        std::cerr << "Invalid benchmark script: " << error.errorString().toStdString() << std::endl;
+        return false;
+    }
+    QJsonObject script = document.object();
+
+    m_width = script.value("width").toInt(m_width);
+    m_height = script.value("height").toInt(m_height);
+    m_timeStep = script.value("timeStep").toDouble(m_timeStep);
+    m_seed = static_cast<uint64_t>(script.value("seed").toDouble(m_seed));
+    m_settleTimeoutMs = script.value("settleTimeoutMs").toInt(m_settleTimeoutMs);
+
+    QString replay = script.value("replay").toString();
+    if (!replay.isEmpty()) {
+        if (!m_replay.load(replay.toStdString()) || m_replay.isEmpty()) {
+            std::cerr << "Benchmark replay " << replay.toStdString() << " is unusable" << std::endl;
+            return false;
+        }
+        m_replaying = true;
+        m_seed = m_replay.getSeed();
+        if (m_frames <= 0 && !script.contains("frames")) {
+            m_frames = static_cast<int>(m_replay.getDuration() / m_timeStep) + 1;
+        }
+    }
+    if (m_frames <= 0) m_frames = script.value("frames").toInt(600);
+
+    // Same defaults as the window's controls
+    QJsonObject options = script.value("settings").toObject();
+    QString mountain = options.value("mountain").toString();
+    settings.mountain = mountain == "rock" ? MountainType::ROCK_MOUNTAIN :
+                        mountain == "grass" ? MountainType::GRASS_MOUNTAIN : MountainType::SNOW_MOUNTAIN;
+    QString weather = options.value("weather").toString();
+    settings.weather = weather == "clear" ? WeatherType::CLEAR :
+                       weather == "rain" ? WeatherType::RAIN : WeatherType::SNOW;
+    settings.weatherIntensity = options.value("intensity").toDouble(1.0);
+    settings.time = options.value("time").toDouble(12.0);
+    settings.fov = options.value("fov").toDouble(45.0);
+    settings.gpuParticles = options.value("gpuParticles").toBool(false);
+    settings.depthPrepass = options.value("depthPrepass").toBool(false);
+    settings.dynamicResolution = options.value("dynamicResolution").toBool(false);
+    settings.targetFrameMs = options.value("targetFrameMs").toDouble(16.6);
+    settings.showProfiler = false;
+
+    for (const QJsonValue& value : script.value("waypoints").toArray()) {
+        QJsonObject waypoint = value.toObject();
+        m_waypoints.push_back(Waypoint{
+            waypoint.value("frame").toInt(),
+            toVec3(waypoint.value("eye"), glm::vec3(150, 20, 0)),
+            toVec3(waypoint.value("look"), glm::vec3(0, 0, 0)),
+            waypoint.value("settle").toBool(false)});
+    }
+    if (m_waypoints.empty() && !m_replaying) {
+        std::cerr << "Benchmark script has no waypoints" << std::endl;
+        return false;
+    }
+    std::sort(m_waypoints.begin(), m_waypoints.end(),
+              [](const Waypoint& a, const Waypoint& b) { return a.frame < b.frame; });
+    return true;
+}
+
+// Linear between the surrounding waypoints, held at either end
+void Benchmark::cameraAt(int frame, glm::vec3& eye, glm::vec3& look) const {
+    if (m_replaying) {
+        m_replay.cameraAt(frame * m_timeStep, eye, look);
+        return;
+    }
+    auto next = std::find_if(m_waypoints.begin(), m_waypoints.end(),
+                             [frame](const Waypoint& w) { return w.frame > frame; });
+    if (next == m_waypoints.begin() || next == m_waypoints.end()) {
+        const Waypoint& held = next == m_waypoints.end() ? m_waypoints.back() : m_waypoints.front();
+        eye = held.eye;
+        look = held.look;
+        return;
+    }
+    const Waypoint& previous = *(next - 1);
+    float t = float(frame - previous.frame) / float(next->frame - previous.frame);
+    eye = glm::mix(previous.eye, next->eye, t);
+    look = glm::mix(previous.look, next->look, t);
+}
+
+int Benchmark::run() {
+    if (!loadScript()) return 1;
+
+    GLRenderer renderer;
+    if (!renderer.initializeHeadless(m_width, m_height, m_seed)) return 1;
+    renderer.settingsChanged();
+
+    std::vector<double> frameMs;
+    std::vector<Settle> settles;
+    size_t peakBufferBytes = 0;
+    size_t peakTextureBytes = 0;
+    auto trackPeaks = [&]() {
+        peakBufferBytes = std::max(peakBufferBytes, renderer.getStats().bufferBytes);
+        peakTextureBytes = std::max(peakTextureBytes, renderer.getStats().textureBytes);
+    };
+
+    frameMs.reserve(m_frames);
+    QElapsedTimer timer;
+    for (int frame = 0; frame < m_frames; frame++) {
+        glm::vec3 eye, look;
+        cameraAt(frame, eye, look);
+        renderer.setCamera(eye, look);
+
+        bool settle = std::any_of(m_waypoints.begin(), m_waypoints.end(),
+                                  [frame](const Waypoint& w) { return w.frame == frame && w.settle; });
+        if (settle) {
+            // Keep rendering the same view until streaming catches up
+            Settle result{frame, 0.0, 0, false};
+            timer.start();
+            while (!(result.complete = renderer.isTerrainComplete()) && timer.elapsed() < m_settleTimeoutMs) {
+                renderer.requestMissingChunks();
+                renderer.renderHeadlessFrame(m_timeStep);
+                trackPeaks();
+                result.frames++;
+            }
+            result.ms = timer.nsecsElapsed() * 1e-6;
+            settles.push_back(result);
+        }
+
+        timer.start();
+        renderer.renderHeadlessFrame(m_timeStep);
+        frameMs.push_back(timer.nsecsElapsed() * 1e-6);
+        trackPeaks();
+    }
+
+    if (!writeResults(frameMs, settles, renderer.getStats(), peakBufferBytes, peakTextureBytes)) return 1;
+    std::cout << "Benchmark results written to " << m_outputPath.toStdString() << std::endl;
+    return 0;
+}
+
+bool Benchmark::writeResults(const std::vector<double>& frameMs, const std::vector<Settle>& settles,
+                             const RendererStats& stats, size_t peakBufferBytes, size_t peakTextureBytes) const {
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double ms : sorted) total += ms;
+
+    QJsonObject frames;
+    frames.insert("count", static_cast<int>(sorted.size()));
+    frames.insert("meanMs", sorted.empty() ? 0.0 : total / sorted.size());
+    frames.insert("p50Ms", percentile(sorted, 50));
+    frames.insert("p90Ms", percentile(sorted, 90));
+    frames.insert("p95Ms", percentile(sorted, 95));
+    frames.insert("p99Ms", percentile(sorted, 99));
+    frames.insert("maxMs", sorted.empty() ? 0.0 : sorted.back());
+
+    QJsonArray fills;
+    double maxFillMs = 0.0;
+    for (const Settle& settle : settles) {
+        QJsonObject fill;
+        fill.insert("frame", settle.frame);
+        fill.insert("ms", settle.ms);
+        fill.insert("frames", settle.frames);
+        fill.insert("complete", settle.complete);
+        fills.append(fill);
+        maxFillMs = std::max(maxFillMs, settle.ms);
+    }
+    QJsonObject chunkFill;
+    chunkFill.insert("settles", fills);
+    chunkFill.insert("maxMs", maxFillMs);
+
+    QJsonObject requests;
+    requests.insert("count", static_cast<qint64>(stats.chunkRequests));
+    requests.insert("hash", QString::number(static_cast<qulonglong>(stats.chunkRequestHash), 16));
+
+    QJsonObject memory;
+    memory.insert("peakBufferBytes", static_cast<qint64>(peakBufferBytes));
+    memory.insert("peakTextureBytes", static_cast<qint64>(peakTextureBytes));
+    memory.insert("peakRssBytes", static_cast<qint64>(peakRssBytes()));
+
+    QJsonObject results;
+    results.insert("script", m_scriptPath);
+    results.insert("width", m_width);
+    results.insert("height", m_height);
+    results.insert("timeStep", m_timeStep);
+    results.insert("frameTime", frames);
+    results.insert("chunkFill", chunkFill);
+    results.insert("chunkRequests", requests);
+    results.insert("memory", memory);
+
+    QFile file(m_outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        std::cerr << "Failed to write benchmark results " << m_outputPath.toStdString() << std::endl;
+        return false;
+    }
+    file.write(QJsonDocument(results).toJson());
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QString>
+#include <vector>
+#include "glm/glm.hpp"
+#include "utils/cameraRecording.h"
+#include "utils/rendererStats.h"
+
+// Headless benchmark: flies a scripted camera path through an offscreen renderer at a
+// fixed timestep and writes frame-time percentiles, terrain fill latency and memory
+// peaks to JSON. Script format:
+//
+// {
+//   "width": 1280, "height": 720, "frames": 600, "timeStep": 0.0166667, "seed": 1,
+//   "settings": { "mountain": "rock", "weather": "snow", "intensity": 1.0,
+//                 "time": 12, "fov": 45, "gpuParticles": false, "depthPrepass": false,
+//                 "dynamicResolution": false, "targetFrameMs": 16.6 },
+//   "waypoints": [
+//     { "frame": 0,   "eye": [150, 20, 0], "look": [0, 0, 0], "settle": true },
+//     { "frame": 600, "eye": [900, 25, 0], "look": [1000, 10, 0] }
+//   ]
+// }
+//
+// The camera moves linearly between waypoints. At a waypoint with "settle" the flight
+// pauses until every chunk within render distance is resident; those frames are timed
+// as fill latency, not as part of the flight.
+//
+// Instead of waypoints, "replay": "path.nwcr" flies a recording made with --record,
+// sampled every timeStep and with the recording's particle seed. Frames default to the
+// recording's length, and waypoints then only mark settle frames. Results include the
+// count and hash of chunk requests, which match between replays of the same recording.
+class Benchmark {
+public:
+    // frames > 0 overrides the script's frame count
+    Benchmark(const QString& scriptPath, int frames, const QString& outputPath);
+
+    // Returns the process exit code
+    int run();
+
+private:
+    struct Waypoint {
+        int frame;
+        glm::vec3 eye;
+        glm::vec3 look;
+        bool settle;
+    };
+
+    struct Settle {
+        int frame;
+        double ms;
+        int frames;
+        bool complete;
+    };
+
+    bool loadScript();
+    void cameraAt(int frame, glm::vec3& eye, glm::vec3& look) const;
+    bool writeResults(const std::vector<double>& frameMs, const std::vector<Settle>& settles,
+                      const RendererStats& stats, size_t peakBufferBytes, size_t peakTextureBytes) const;
+
+    QString m_scriptPath;
+    QString m_outputPath;
+    int m_frames;
+    int m_width = 1280;
+    int m_height = 720;
+    float m_timeStep = 1.0f / 60.0f;
+    uint64_t m_seed = 1;
+    int m_settleTimeoutMs = 60000;
+    std::vector<Waypoint> m_waypoints;
+    CameraRecording m_replay;
+    bool m_replaying = false;
+};
@@ -1,5 +1,7 @@
 #include "glrenderer.h"
 #include <QCoreApplication>
+#include <QPainter>
+#include <QFontMetrics>
 #include "src/shaderloader.h"
 #include <cmath>
 #include "glm/gtc/constants.hpp"
@@ -7,6 +9,24 @@
 #include "glm/gtx/transform.hpp"
 #include "settings.h"
 #include "utils/particle.h"
+#include "utils/trace.h"
+#include <iostream>
+#include <cstdio>
+#include <random>
+
+// Terrain textures in the order terrain.frag's samplers are bound. Each shader variant
+// samples only a subset.
+const GLRenderer::TextureSlot GLRenderer::TERRAIN_TEXTURES[TERRAIN_TEXTURE_COUNT] = {
+    {":/resources/images/front-view-tree-bark.jpg",                          &GLRenderer::m_textureID2}, // rock
+    {":/resources/images/natural-landscape.jpg",                             &GLRenderer::m_textureID3}, // grass
+    {":/resources/images/top-view-corn-flour-texture.jpg",                   &GLRenderer::m_textureID4}, // sand
+    {":/resources/images/snowNewtop.jpg",                                    &GLRenderer::m_textureID6}, // snowTop
+    {":/resources/images/snowSand.jpg",                                      &GLRenderer::m_textureID7}, // snowSand
+    {":/resources/images/grassTop.jpg",                                      &GLRenderer::m_textureID8}, // grassTop
+    {":/resources/images/rockSand.jpg",                                      &GLRenderer::m_textureID9}, // rockSand
+    {":/resources/images/seaFloor.jpg",                                      &GLRenderer::m_textureID10}, // seafloor
+    {":/resources/images/rockMiddle.jpg",                                    &GLRenderer::m_textureID11}, // rockMiddle
+};
 
 
 GLRenderer::GLRenderer(QWidget* parent)
@@ -47,20 +67,40 @@ GLRenderer::GLRenderer(QWidget* parent)
 
 GLRenderer::~GLRenderer()
 {
-    makeCurrent();
-    killTimer(m_timer);
+    makeRendererCurrent();
+    if (m_recording) m_recording->save(m_recordingPath);
+    // Completes uploads that already ran, so everything they made is freed below
+    m_uploader.shutdown();
 
     // Delete terrain resources
     glDeleteBuffers(1, &m_terrainVbo);
     glDeleteVertexArrays(1, &m_terrainVao);
-    if (m_terrain_shader) glDeleteProgram(m_terrain_shader);
+    // Owns the terrain programs
+    ShaderLoader::releaseVariants([this](GLuint program) { m_uniforms.releaseProgram(program); });
+    m_uniforms.releaseFrameBuffer();
+    m_profiler.release();
 
     // Delete dome resources
     glDeleteBuffers(1, &m_sphere_vbo);
     glDeleteVertexArrays(1, &m_sphere_vao);
-    if (m_skydome_shader) glDeleteProgram(m_skydome_shader);
+    deleteProgram(m_skydome_shader);
+    deleteProgram(m_skylut_shader);
+    deleteProgram(m_terrain_depth_shader);
+    if (m_skyLutTexture) glDeleteTextures(1, &m_skyLutTexture);
+    for (const auto& entry : TERRAIN_TEXTURES) {
+        GLuint& texture = this->*entry.texture;
+        if (texture) glDeleteTextures(1, &texture);
+    }
+    if (m_skyLutFbo) glDeleteFramebuffers(1, &m_skyLutFbo);
+    if (m_sceneFbo) glDeleteFramebuffers(1, &m_sceneFbo);
+    if (m_sceneColor) glDeleteTextures(1, &m_sceneColor);
+    if (m_sceneDepth) glDeleteRenderbuffers(1, &m_sceneDepth);
+    deleteProgram(m_upscale_shader);
+    m_dynamicResolution.release();
+    if (m_fullscreen_vao) glDeleteVertexArrays(1, &m_fullscreen_vao);
 
     // Clean up water resources
+    deleteProgram(m_water_shader);
     if (m_water_disp_texture) {
         glDeleteTextures(1, &m_water_disp_texture);
     }
@@ -78,13 +118,153 @@ GLRenderer::~GLRenderer()
         glDeleteVertexArrays(1, &chunk.vao);
     }
     m_terrainChunks.clear();
+    m_chunkDrawOrder.clear();
 
     // Delete particle resources
-    if (m_particle_vbo) glDeleteBuffers(1, &m_particle_vbo);
+    for (GLsync& fence : m_particleFences) {
+        if (fence) glDeleteSync(fence);
+    }
+    if (m_particle_vbo) glDeleteBuffers(1, &m_particle_vbo); // Also releases the persistent mapping
     if (m_particle_vao) glDeleteVertexArrays(1, &m_particle_vao);
-    if (m_particle_shader) glDeleteProgram(m_particle_shader);
+    deleteProgram(m_particle_shader);
+    deleteProgram(m_particle_update_shader);
+    if (m_gpu_particle_vbo[0]) glDeleteBuffers(2, m_gpu_particle_vbo);
+    if (m_gpu_update_vao[0]) glDeleteVertexArrays(2, m_gpu_update_vao);
+    if (m_gpu_render_vao[0]) glDeleteVertexArrays(2, m_gpu_render_vao);
+    if (m_heightGridTexture) glDeleteTextures(1, &m_heightGridTexture);
+    if (m_offscreenFbo) glDeleteFramebuffers(1, &m_offscreenFbo);
+    if (m_offscreenRenderbuffers[0]) glDeleteRenderbuffers(2, m_offscreenRenderbuffers);
+
+    doneRendererCurrent();
+}
+
+// ================== Render target
 
-    doneCurrent();
+void GLRenderer::makeRendererCurrent() {
+    if (m_offscreenContext) m_offscreenContext->makeCurrent(m_offscreenSurface.get());
+    else makeCurrent();
+}
+
+void GLRenderer::doneRendererCurrent() {
+    if (m_offscreenContext) m_offscreenContext->doneCurrent();
+    else doneCurrent();
+}
+
+// Drops the program's uniform tables along with it, so a reused name starts clean
+void GLRenderer::deleteProgram(GLuint& program) {
+    if (!program) return;
+    m_uniforms.releaseProgram(program);
+    glDeleteProgram(program);
+    program = 0;
+}
+
+GLuint GLRenderer::renderTarget() {
+    return m_sceneActive ? m_sceneFbo : outputTarget();
+}
+
+GLuint GLRenderer::outputTarget() {
+    return m_offscreenContext ? m_offscreenFbo : defaultFramebufferObject();
+}
+
+int GLRenderer::renderWidth() const {
+    return m_offscreenContext ? m_offscreenSize.x : width();
+}
+
+int GLRenderer::renderHeight() const {
+    return m_offscreenContext ? m_offscreenSize.y : height();
+}
+
+// Creates a context on an offscreen surface and renders into an FBO of the given size.
+// The widget itself is never shown; frames are driven by renderHeadlessFrame().
+bool GLRenderer::initializeHeadless(int width, int height, uint64_t seed) {
+    m_offscreenSurface = std::make_unique<QOffscreenSurface>();
+    m_offscreenSurface->setFormat(QSurfaceFormat::defaultFormat());
+    m_offscreenSurface->create();
+    m_offscreenContext = std::make_unique<QOpenGLContext>();
+    m_offscreenContext->setFormat(QSurfaceFormat::defaultFormat());
+    if (!m_offscreenSurface->isValid() || !m_offscreenContext->create() ||
+        !m_offscreenContext->makeCurrent(m_offscreenSurface.get())) {
+        std::cerr << "Failed to create an offscreen OpenGL context" << std::endl;
+        m_offscreenContext.reset();
+        m_offscreenSurface.reset();
+        return false;
+    }
+    m_offscreenSize = glm::ivec2(width, height);
+
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW on the offscreen context" << std::endl;
+        return false;
+    }
+    glGenRenderbuffers(2, m_offscreenRenderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenRenderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_offscreenRenderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &m_offscreenFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_offscreenRenderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_offscreenRenderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+        return false;
+    }
+    glViewport(0, 0, width, height);
+
+    initializeGL();
+    // Every frame measured should be textured
+    m_uploader.finish();
+    if (m_particleSystem) {
+        // Identical particle workload on every run
+        m_particleSystem->seed(seed);
+        m_particleSystem->reset();
+    }
+    resizeGL(width, height);
+    doneRendererCurrent();
+    return true;
+}
+
+// One fixed-step frame: deliver finished chunks, simulate, draw and wait for the GPU
+void GLRenderer::renderHeadlessFrame(float deltaTime) {
+    QCoreApplication::processEvents();
+    advance(deltaTime);
+    makeRendererCurrent();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_offscreenFbo);
+    glViewport(0, 0, m_offscreenSize.x, m_offscreenSize.y);
+    paintGL();
+    glFinish();
+    doneRendererCurrent();
+}
+
+void GLRenderer::setCamera(const glm::vec3& eye, const glm::vec3& look) {
+    m_autoRotate = false;
+    m_eye = eye;
+    m_look = look;
+    rebuildMatrices();
+}
+
+// True once every chunk within RENDER_DISTANCE of the camera is resident
+bool GLRenderer::isTerrainComplete() const {
+    glm::ivec2 center(static_cast<int>(m_eye.x / TerrainGenerator::CHUNK_SIZE),
+                      static_cast<int>(m_eye.z / TerrainGenerator::CHUNK_SIZE));
+    size_t resident = 0;
+    for (const auto& [key, chunk] : m_terrainChunks) {
+        glm::ivec2 offset = glm::abs(chunk.position - center);
+        if (offset.x <= RENDER_DISTANCE && offset.y <= RENDER_DISTANCE) resident++;
+    }
+    return resident == size_t(2 * RENDER_DISTANCE + 1) * (2 * RENDER_DISTANCE + 1);
+}
+
+// Requests are only made when the camera changes chunk, so a stationary camera re-requests
+// anything the queue refused once it drains; chunks already requested are not repeated
+void GLRenderer::requestMissingChunks() {
+    TerrainGenerationQueue::Stats queue = m_terrainQueue->getStats();
+    if (queue.pending == 0 && queue.inFlight == 0) {
+        makeRendererCurrent();
+        updateTerrainChunks(true);
+        doneRendererCurrent();
+    }
 }
 
 // ================== Helper Functions
@@ -176,16 +356,28 @@ std::vector<float> generateDomeData(int phiTesselations, int thetaTesselations)
 }
 
 void GLRenderer::initializeGL() {
-    m_timer = startTimer(1000 / 60);
+    // Headless frames are stepped by the caller at a fixed rate
+    if (!m_offscreenContext) {
+        // Each swap (once per display refresh with vsync) steps the simulation and asks for
+        // the next frame
+        connect(this, &QOpenGLWidget::frameSwapped, this, &GLRenderer::onFrameSwapped);
+
+        glewExperimental = GL_TRUE;
+        GLenum err = glewInit();
+        if (err != GLEW_OK)
+            fprintf(stderr, "Error while initializing GLEW: %s\n", glewGetErrorString(err));
+        fprintf(stdout, "Successfully initialized GLEW %s\n", glewGetString(GLEW_VERSION));
+    }
     m_elapsedTimer.start();
-
-    glewExperimental = GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK)
-        fprintf(stderr, "Error while initializing GLEW: %s\n", glewGetErrorString(err));
-    fprintf(stdout, "Successfully initialized GLEW %s\n", glewGetString(GLEW_VERSION));
+    resetCameraInterpolation();
 
     glClearColor(0, 0, 0, 1);
+    m_profiler.initialize();
+    m_profiler.setEnabled(settings.showProfiler);
+    m_dynamicResolution.initialize();
+    if (!settings.statsLogPath.empty()) {
+        m_statsLogger.open(settings.statsLogPath, settings.statsLogInterval);
+    }
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -193,20 +385,33 @@ void GLRenderer::initializeGL() {
     try {
         // Initialize shaders
         m_skydome_shader = ShaderLoader::createShaderProgram(":/resources/shaders/skydome.vert", ":/resources/shaders/skydome.frag");
-        m_terrain_shader = ShaderLoader::createShaderProgram(":/resources/shaders/terrain.vert", ":/resources/shaders/terrain.frag");
+        m_skylut_shader = ShaderLoader::createShaderProgram(":/resources/shaders/fullscreen.vert", ":/resources/shaders/skylut.frag");
+        // Build every terrain variant up front so switching mountains never stalls on a compile
+        for (MountainType mountain : {MountainType::SNOW_MOUNTAIN, MountainType::ROCK_MOUNTAIN, MountainType::GRASS_MOUNTAIN}) {
+            terrainVariant(mountain);
+        }
+        m_terrain_shader = terrainVariant(settings.mountain);
         m_particle_shader = ShaderLoader::createShaderProgram(":/resources/shaders/particle.vert", ":/resources/shaders/particle.frag");
         m_water_shader = ShaderLoader::createShaderProgram(":/resources/shaders/water.vert", ":/resources/shaders/water.frag");
+        m_terrain_depth_shader = ShaderLoader::createShaderProgram(":/resources/shaders/terrain.vert", ":/resources/shaders/depth.frag");
+        m_upscale_shader = ShaderLoader::createShaderProgram(":/resources/shaders/fullscreen.vert", ":/resources/shaders/upscale.frag");
+        for (GLuint program : {m_skydome_shader, m_skylut_shader, m_particle_shader, m_water_shader, m_terrain_depth_shader, m_upscale_shader}) {
+            m_uniforms.registerProgram(program);
+        }
 
         // Initialize dome
         glGenBuffers(1, &m_sphere_vbo);
         glBindBuffer(GL_ARRAY_BUFFER, m_sphere_vbo);
         m_sphereData = generateDomeData(25, 25);
         glBufferData(GL_ARRAY_BUFFER, m_sphereData.size() * sizeof(GLfloat), m_sphereData.data(), GL_STATIC_DRAW);
+        m_fixedBufferBytes += m_sphereData.size() * sizeof(GLfloat);
         glGenVertexArrays(1, &m_sphere_vao);
         glBindVertexArray(m_sphere_vao);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(0));
+        initializeSkyLut();
 
+        m_uploader.start(m_offscreenContext ? m_offscreenContext.get() : context());
         bindTerrainTexture();
         updateTerrainChunks(true);
 
@@ -224,6 +429,7 @@ void GLRenderer::initializeGL() {
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
             m_disp_image.width(), m_disp_image.height(), 0,
             GL_RGBA, GL_UNSIGNED_BYTE, m_disp_image.bits());
+        m_textureBytes += size_t(m_disp_image.width()) * m_disp_image.height() * 4;
 
         // Set texture parameters
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -245,372 +451,558 @@ void GLRenderer::initializeGL() {
     catch (const std::exception& e) {
         fprintf(stderr, "Error during initialization: %s\n", e.what());
     }
+
+    if (!m_offscreenContext) {
+        if (!settings.recordPath.empty()) startRecording(settings.recordPath);
+        else if (!settings.replayPath.empty()) startReplay(settings.replayPath);
+    }
 }
 
 void GLRenderer::paintGL()
 {
+    TRACE_SCOPE("Frame");
+
+    // The profiler overlay paints with QPainter, which leaves its own state behind
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // The output viewport is set up by the widget, or by renderHeadlessFrame
+    GLint outputViewport[4];
+    glGetIntegerv(GL_VIEWPORT, outputViewport);
+    m_sceneActive = settings.dynamicResolution && m_upscale_shader && outputViewport[2] > 0 && outputViewport[3] > 0;
+    if (m_sceneActive) {
+        glm::ivec2 outputSize(outputViewport[2], outputViewport[3]);
+        if (outputSize != m_sceneSize) resizeSceneTarget(outputSize);
+        m_dynamicResolution.update(settings.targetFrameMs);
+        m_sceneViewport = glm::max(glm::ivec2(glm::vec2(outputSize) * m_dynamicResolution.getScale() + 0.5f), glm::ivec2(1));
+        glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+        glViewport(0, 0, m_sceneViewport.x, m_sceneViewport.y);
+        m_dynamicResolution.beginFrame();
+    }
+    else {
+        m_dynamicResolution.reset();
+    }
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    m_frameRequested = false;
+    if (m_uploader.getPending() > 0) {
+        FrameProfiler::Scope scope(m_profiler, FrameProfiler::CHUNK_UPLOAD);
+        TRACE_SCOPE("Finish uploads");
+        m_uploader.collect();
+    }
+    // Draw from the camera between the last two simulation steps; headless frames are
+    // stepped exactly, so they use the latest state
+    float alpha = m_offscreenContext ? 1.0f : static_cast<float>(m_stepAccumulator / SIMULATION_TIME_STEP);
+    m_renderEye = glm::mix(m_prevEye, m_eye, alpha);
+    m_view = glm::lookAt(m_renderEye, glm::mix(m_prevLook, m_look, alpha), m_up);
+    updateFrameData();
+
     // Paint terrain first
-    paintTerrain();
+    {
+        FrameProfiler::Scope scope(m_profiler, FrameProfiler::TERRAIN);
+        TRACE_SCOPE("Draw terrain");
+        paintTerrain();
+    }
 
     // Paint dome
-    paintDome();
+    {
+        FrameProfiler::Scope scope(m_profiler, FrameProfiler::DOME);
+        TRACE_SCOPE("Draw sky");
+        paintDome();
+    }
 
     // Paint water
     // paintWater();
-    paintWaterPlanes();
+    {
+        FrameProfiler::Scope scope(m_profiler, FrameProfiler::WATER);
+        TRACE_SCOPE("Draw water");
+        paintWaterPlanes();
+    }
 
     // Paint particles last for proper transparency
-    if (m_weatherEnabled && m_particleSystem) {
+    if (m_particleSystem && m_particleSystem->getActiveCount() > 0) {
+        FrameProfiler::Scope scope(m_profiler, FrameProfiler::PARTICLES);
+        TRACE_SCOPE("Draw particles");
         renderParticles();
     }
-}
-
-void GLRenderer::initializeParticleSystem() {
-    m_particleSystem = std::make_unique<ParticleSystem>(10000);
-    m_particleSystem->setParticleType(m_isSnow);
-    m_particleSystem->setEmissionArea(400.0f, 400.0f);
-
-    glGenVertexArrays(1, &m_particle_vao);
-    glGenBuffers(1, &m_particle_vbo);
-
-    glBindVertexArray(m_particle_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_particle_vbo);
-
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Particle) * 10000, nullptr, GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)0);
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, size));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, life));
-}
-
-void GLRenderer::setWeatherType(bool isSnow) {
-    if (!m_particleSystem) return;  // Guard against null pointer
-
-    makeCurrent();  // Ensure OpenGL context is current
-    m_isSnow = isSnow;
-    m_particleSystem->setParticleType(isSnow);
-    update();
-    doneCurrent();
-}
-
-void GLRenderer::bindTerrainTexture() {
-
-    glUseProgram(m_terrain_shader);
-
-    QString snow_filepath = QString(":/resources/images/indian-travel-destination-beautiful-attractive.jpg");
-    //QString kitten_filepath = QString(":/resources/images/front-view-tree-bark.jpg");
 
-    if (!m_image.load(snow_filepath)) {
-        std::cerr << "Failed to load texture: " << snow_filepath.toStdString() << std::endl;
-        return;
+    if (m_sceneActive) {
+        m_dynamicResolution.endFrame();
+        m_sceneActive = false;
+        glBindFramebuffer(GL_FRAMEBUFFER, outputTarget());
+        glViewport(outputViewport[0], outputViewport[1], outputViewport[2], outputViewport[3]);
+        upscaleScene();
     }
 
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888); // Ensure format compatibility
-
-    // Task 2: Generate texture
-    glGenTextures(1, &m_textureID);
-    // Task 9: Set the active texture slot to texture slot 0
-    glActiveTexture(GL_TEXTURE0);
-
-    glBindTexture(GL_TEXTURE_2D, m_textureID);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-
-
-    glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture
+    updateStats();
+    if (m_profiler.isEnabled() && !m_offscreenContext) {
+        paintProfilerOverlay();
+    }
+}
 
-    // Load the second texture
-    QString rock_filepath = QString(":/resources/images/front-view-tree-bark.jpg");
-    if (!m_image.load(rock_filepath)) {
-        std::cerr << "Failed to load texture: " << rock_filepath.toStdString() << std::endl;
-        return;
+// Allocates the scaled scene target at the output size, so scale changes never reallocate
+void GLRenderer::resizeSceneTarget(const glm::ivec2& size) {
+    m_textureBytes -= size_t(m_sceneSize.x) * m_sceneSize.y * 8;
+    if (!m_sceneFbo) {
+        glGenFramebuffers(1, &m_sceneFbo);
+        glGenTextures(1, &m_sceneColor);
+        glGenRenderbuffers(1, &m_sceneDepth);
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
+    m_sceneSize = size;
 
-    glGenTextures(1, &m_textureID2);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_textureID2);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, m_sceneColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glBindTexture(GL_TEXTURE_2D, 0);
-
-    QString grass_filepath = QString(":/resources/images/natural-landscape.jpg");
-    if (!m_image.load(grass_filepath)) {
-        std::cerr << "Failed to load texture: " << grass_filepath.toStdString() << std::endl;
-        return;
+    glBindRenderbuffer(GL_RENDERBUFFER, m_sceneDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    m_textureBytes += size_t(size.x) * size.y * 8;  // Color and depth-stencil
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_sceneFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_sceneColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_sceneDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Scene framebuffer is incomplete" << std::endl;
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
-
-    // Generate and bind texture ID for grass
-    glGenTextures(1, &m_textureID3);
-    glActiveTexture(GL_TEXTURE2); // Use texture unit 2 for grass texture
-    glBindTexture(GL_TEXTURE_2D, m_textureID3);
-
-    // Upload texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+}
 
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void GLRenderer::upscaleScene() {
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
 
-    // Unbind texture
+    float scale = float(m_sceneViewport.x) / float(m_sceneSize.x);
+    m_uniforms.use(m_upscale_shader);
+    m_uniforms.setInt("scene", 0);
+    m_uniforms.setVec2("uvScale", glm::vec2(m_sceneViewport) / glm::vec2(m_sceneSize));
+    m_uniforms.setVec2("texelSize", 1.0f / glm::vec2(m_sceneSize));
+    // No sharpening at full resolution, the most at the lowest scale
+    m_uniforms.setFloat("sharpness", (1.0f - scale) / (1.0f - DynamicResolution::MIN_SCALE) * UPSCALE_SHARPNESS);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_sceneColor);
+    glBindVertexArray(m_fullscreen_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    countDraw(GL_TRIANGLES, 3);
+    glBindVertexArray(0);
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    // Load sand texture
-    QString sand_filepath = QString(":/resources/images/top-view-corn-flour-texture.jpg");
-    if (!m_image.load(sand_filepath)) {
-        std::cerr << "Failed to load texture: " << sand_filepath.toStdString() << std::endl;
-        return;
+    glEnable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void GLRenderer::updateStats() {
+    m_stats.frame++;
+    if (m_terrainQueue) {
+        TerrainGenerationQueue::Stats queue = m_terrainQueue->getStats();
+        m_stats.pendingChunks = queue.pending;
+        m_stats.inFlightChunks = queue.inFlight;
+        m_stats.droppedChunks = queue.dropped;
+    }
+    m_stats.chunkRequests = m_chunkRequests;
+    m_stats.chunkRequestHash = m_chunkRequestHash;
+    m_stats.terrainChunks = m_terrainChunks.size();
+    m_stats.waterPlanes = m_waterPlanes.size();
+
+    // Chunk and plane buffers come and go, so they are summed rather than tracked
+    size_t bufferBytes = m_fixedBufferBytes;
+    for (const auto& [key, chunk] : m_terrainChunks) {
+        bufferBytes += size_t(chunk.vertexCount) * 11 * sizeof(float);
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
+    for (const auto& [key, plane] : m_waterPlanes) {
+        bufferBytes += size_t(plane.vertexCount) * 5 * sizeof(float);
+    }
+    m_stats.bufferBytes = bufferBytes;
+    m_stats.textureBytes = m_textureBytes;
 
-    // Generate and bind texture ID for sand
-    glGenTextures(1, &m_textureID4);
-    glActiveTexture(GL_TEXTURE3); // Bind to texture unit 3
-    glBindTexture(GL_TEXTURE_2D, m_textureID4);
+    m_stats.drawCalls = m_drawCalls;
+    m_stats.triangles = m_triangles;
+    m_drawCalls = 0;
+    m_triangles = 0;
+    m_stats.particles = m_particleSystem ? m_particleSystem->getActiveCount() : 0;
 
-    // Upload sand texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    m_statsLogger.log(m_stats);
+}
 
-    // Set texture parameters for sand texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// Text drawn with QPainter over the finished frame
+void GLRenderer::paintProfilerOverlay() {
+    QFont font;
+    font.setFamily("monospace");
+    font.setStyleHint(QFont::TypeWriter);
+    font.setPointSize(10);
+    QFontMetrics metrics(font);
+    int lineHeight = metrics.height();
+
+    std::vector<QString> lines;
+    lines.push_back("ms               cpu min   avg   p99 | gpu min   avg   p99");
+    for (int i = 0; i < FrameProfiler::SECTION_COUNT; i++) {
+        auto section = static_cast<FrameProfiler::Section>(i);
+        FrameProfiler::Stats cpu = m_profiler.cpuStats(section);
+        FrameProfiler::Stats gpu = m_profiler.gpuStats(section);
+        char line[128];
+        snprintf(line, sizeof(line), "%-16s %7.2f %5.2f %5.2f | %7.2f %5.2f %5.2f",
+                 FrameProfiler::sectionName(section), cpu.min, cpu.avg, cpu.p99, gpu.min, gpu.avg, gpu.p99);
+        lines.push_back(QString(line));
+    }
+    if (settings.dynamicResolution) {
+        char line[128];
+        snprintf(line, sizeof(line), "resolution %3.0f%%   gpu frame %5.2f ms, target %5.2f",
+                 m_dynamicResolution.getScale() * 100.0f, m_dynamicResolution.getGpuMs(), settings.targetFrameMs);
+        lines.push_back(QString(line));
+    }
 
-    // Unbind sand texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    int width = 0;
+    for (const QString& line : lines) {
+        width = std::max(width, metrics.horizontalAdvance(line));
+    }
 
-    // Load sea bottom texture
-    QString water_filepath = QString(":/resources/images/water_displacement_1.jpg");
-    if (!m_image.load(water_filepath)) {
-        std::cerr << "Failed to load texture: " << water_filepath.toStdString() << std::endl;
-        return;
+    QPainter painter(this);
+    painter.setFont(font);
+    painter.fillRect(QRect(8, 8, width + 16, lineHeight * static_cast<int>(lines.size()) + 12), QColor(0, 0, 0, 160));
+    painter.setPen(QColor(255, 255, 255));
+    for (size_t i = 0; i < lines.size(); i++) {
+        painter.drawText(16, 14 + lineHeight * static_cast<int>(i + 1) - metrics.descent(), lines[i]);
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
+    painter.end();
+}
 
-    // Generate and bind texture ID for water
-    glGenTextures(1, &m_textureID5);
-    glActiveTexture(GL_TEXTURE4); // Bind to texture unit 4
-    glBindTexture(GL_TEXTURE_2D, m_textureID5);
+// Everything the passes share goes out in one uniform buffer upload per frame
+void GLRenderer::updateFrameData() {
+    float azimuth = m_sunPos.x;
+    float zenith = m_sunPos.y;
+    UniformManager::FrameData frame = {};
+    frame.view = m_view;
+    frame.projection = m_proj;
+    frame.viewProjection = m_proj * m_view;
+    frame.cameraPosition = glm::vec4(m_renderEye, 1.0f);
+    // Same convention as the sky LUT: azimuth from +z towards +x, zenith from +y
+    frame.sunDirection = glm::vec4(glm::sin(zenith) * glm::sin(azimuth), glm::cos(zenith),
+                                   glm::sin(zenith) * glm::cos(azimuth), 0.0f);
+    frame.brightness = m_brightness;
+    frame.time = m_waterAnimTime;
+    m_uniforms.setFrameData(frame);
+}
 
-    // Upload water texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+void GLRenderer::initializeParticleSystem() {
+    m_particleSystem = std::make_unique<ParticleSystem>(10000);
+    m_particleSystem->setParticleType(m_isSnow);
+    m_particleSystem->setIntensity(m_weatherEnabled ? settings.weatherIntensity : 0.0f, false);
+    // The volume travels with the camera, so a smaller box gives the same coverage at higher density
+    m_particleSystem->setEmissionArea(PARTICLE_VOLUME_SIZE, PARTICLE_VOLUME_SIZE);
+    m_particleSystem->setAnchor(m_eye);
+    glm::vec3 lookDir = m_look - m_eye;
+    m_particleSystem->setViewDirection(lookDir);
+    m_particleSystem->setGround(&m_heightGrid);
+    updateHeightGrid();
+    // Respawn the initial particles above the terrain rather than inside it
+    m_particleSystem->reset();
 
-    // Set texture parameters for water texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenVertexArrays(1, &m_particle_vao);
+    glGenBuffers(1, &m_particle_vbo);
 
-    // Unbind water texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(m_particle_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_particle_vbo);
 
-    // Load snowTop texture
-    QString snowTop_filepath = QString(":/resources/images/snowNewtop.jpg");
-    if (!m_image.load(snowTop_filepath)) {
-        std::cerr << "Failed to load texture: " << snowTop_filepath.toStdString() << std::endl;
-        return;
+    // One region per in-flight frame; the CPU writes one while the GPU may still read the others
+    m_particleRegionSize = m_particleSystem->getParticles().size();
+    GLsizeiptr bufferSize = PARTICLE_BUFFER_REGIONS * m_particleRegionSize * sizeof(ParticleVertex);
+    m_fixedBufferBytes += bufferSize;
+    if (GLEW_ARB_buffer_storage) {
+        // Map once and keep the pointer for the lifetime of the buffer
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, flags);
+        m_particleMapped = static_cast<ParticleVertex*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags));
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
-
-    // Generate and bind texture ID for water
-    glGenTextures(1, &m_textureID6);
-    glActiveTexture(GL_TEXTURE5); // Bind to texture unit 4
-    glBindTexture(GL_TEXTURE_2D, m_textureID6);
 
-    // Upload water texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, position));
 
-    // Set texture parameters for water texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, sizeLife));
 
-    // Unbind water texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    initializeGpuParticles();
+    updateHeightGrid();
+}
 
-    // Load snowSand texture
-    QString snowSand_filepath = QString(":/resources/images/snowSand.jpg");
-    if (!m_image.load(snowSand_filepath)) { // Correct filepath here
-        std::cerr << "Failed to load texture: " << snowSand_filepath.toStdString() << std::endl;
-        return;
+// Keeps the collision grid centred on the camera; the GPU copy is refreshed only
+// when the grid actually moved
+void GLRenderer::updateHeightGrid() {
+    bool moved = m_heightGrid.recenter(m_terrain, m_eye.x, m_eye.z);
+    if (!m_particle_update_shader || (!moved && m_heightGridTexture)) return;
+
+    const int resolution = m_heightGrid.getResolution();
+    if (!m_heightGridTexture) {
+        glGenTextures(1, &m_heightGridTexture);
+        glBindTexture(GL_TEXTURE_2D, m_heightGridTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resolution, resolution, 0, GL_RED, GL_FLOAT, nullptr);
+        m_textureBytes += size_t(resolution) * resolution * sizeof(float);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
-
-    // Generate and bind texture ID for snow sand
-    glGenTextures(1, &m_textureID7);
-    glActiveTexture(GL_TEXTURE6); // Use correct texture unit
-    glBindTexture(GL_TEXTURE_2D, m_textureID7);
+    glBindTexture(GL_TEXTURE_2D, m_heightGridTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RED, GL_FLOAT, m_heightGrid.getHeights().data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    // Upload snow sand texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+// Streams the compact render vertices of the CPU simulation into the next buffer region
+void GLRenderer::uploadParticleVertices() {
+    m_particleRegion = (m_particleRegion + 1) % PARTICLE_BUFFER_REGIONS;
 
-    // Set texture parameters for snow sand
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Wait until the GPU has finished drawing from this region (issued two ticks ago)
+    GLsync& fence = m_particleFences[m_particleRegion];
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
 
-    // Unbind water texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    const size_t offset = m_particleRegion * m_particleRegionSize;
+    const glm::vec3 forward = glm::normalize(m_look - m_eye);  // Culling margin covers the interpolation
+    glBindBuffer(GL_ARRAY_BUFFER, m_particle_vbo);
+    if (m_particleMapped) {
+        m_particleDrawCount = m_particleSystem->writeVertices(m_particleMapped + offset, m_eye, forward);
+    }
+    else {
+        // The fence already guarantees the range is idle, so skip the driver's implicit sync
+        void* ptr = glMapBufferRange(GL_ARRAY_BUFFER,
+            offset * sizeof(ParticleVertex), m_particleRegionSize * sizeof(ParticleVertex),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        m_particleDrawCount = ptr ? m_particleSystem->writeVertices(static_cast<ParticleVertex*>(ptr), m_eye, forward) : 0;
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    // Load grassTop texture
-    QString grassTop_filepath = QString(":/resources/images/grassTop.jpg");
-    if (!m_image.load(grassTop_filepath)) {
-        std::cerr << "Failed to load texture: " << grassTop_filepath.toStdString() << std::endl;
+void GLRenderer::initializeGpuParticles() {
+    try {
+        m_particle_update_shader = ShaderLoader::createTransformFeedbackProgram(
+            ":/resources/shaders/particle_update.vert",
+            {"outPosition", "outVelocity", "outSize", "outLife"});
+    }
+    catch (const std::exception& e) {
+        // Fall back to the CPU simulation if transform feedback is unavailable
+        fprintf(stderr, "GPU particle simulation disabled: %s\n", e.what());
+        m_particle_update_shader = 0;
         return;
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
 
-    // Generate and bind texture ID for water
-    glGenTextures(1, &m_textureID8);
-    glActiveTexture(GL_TEXTURE7); // Bind to texture unit 4
-    glBindTexture(GL_TEXTURE_2D, m_textureID8);
-
-    // Upload water texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    const size_t bufferSize = m_particleSystem->getParticles().size() * sizeof(GpuParticle);
+    glGenBuffers(2, m_gpu_particle_vbo);
+    glGenVertexArrays(2, m_gpu_update_vao);
+    glGenVertexArrays(2, m_gpu_render_vao);
 
-    // Set texture parameters for water texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // Unbind water texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_gpu_particle_vbo[i]);
+        glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_COPY);
+        m_fixedBufferBytes += bufferSize;
 
-    // Load rockSand texture
-    QString rockSand_filepath = QString(":/resources/images/rockSand.jpg");
-    if (!m_image.load(rockSand_filepath)) {
-        std::cerr << "Failed to load texture: " << rockSand_filepath.toStdString() << std::endl;
-        return;
+        // Simulation input: full particle state
+        glBindVertexArray(m_gpu_update_vao[i]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, velocity));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, size));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, life));
+
+        // Rendering input: position plus the adjacent size/life pair particle.vert reads
+        glBindVertexArray(m_gpu_render_vao[i]);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)offsetof(GpuParticle, size));
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
 
-    // Generate and bind texture ID for water
-    glGenTextures(1, &m_textureID9);
-    glActiveTexture(GL_TEXTURE8); // Bind to texture unit 4
-    glBindTexture(GL_TEXTURE_2D, m_textureID9);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    // Upload water texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    m_gpuParticleSrc = 0;
+    uploadGpuParticles();
+}
 
-    // Set texture parameters for water texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// Seeds (part of) the GPU simulation from the CPU particle state, e.g. when switching
+// modes or when the intensity ramp activates more particles
+void GLRenderer::uploadGpuParticles(size_t first, size_t count) {
+    if (!m_particle_update_shader) return;
 
+    const auto& particles = m_particleSystem->getParticles();
+    count = std::min(count, particles.size() - first);
+    std::vector<GpuParticle> gpuParticles(count);
+    for (size_t i = 0; i < count; i++) {
+        const Particle& p = particles[first + i];
+        gpuParticles[i].position = p.position;
+        gpuParticles[i].velocity = p.velocity;
+        gpuParticles[i].size = p.size;
+        gpuParticles[i].life = p.life;
+    }
 
-    // Unbind water texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, m_gpu_particle_vbo[m_gpuParticleSrc]);
+    glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(GpuParticle), gpuParticles.size() * sizeof(GpuParticle), gpuParticles.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    // Load rockSand texture
-    QString seaFloor_filepath = QString(":/resources/images/seaFloor.jpg");
-    if (!m_image.load(seaFloor_filepath)) {
-        std::cerr << "Failed to load texture: " << seaFloor_filepath.toStdString() << std::endl;
-        return;
+void GLRenderer::updateGpuParticles(float deltaTime) {
+    // The ramp runs on the CPU; particles it activates are seeded into the source buffer
+    size_t previousCount = m_particleSystem->advanceIntensity(deltaTime);
+    size_t activeCount = m_particleSystem->getActiveCount();
+    if (activeCount > previousCount) {
+        uploadGpuParticles(previousCount, activeCount - previousCount);
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
 
-    // Generate and bind texture ID for water
-    glGenTextures(1, &m_textureID10);
-    glActiveTexture(GL_TEXTURE9); // Bind to texture unit 4
-    glBindTexture(GL_TEXTURE_2D, m_textureID10);
-
-    // Upload water texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    const int dst = 1 - m_gpuParticleSrc;
+
+    m_uniforms.use(m_particle_update_shader);
+    m_uniforms.setFloat("deltaTime", deltaTime);
+    m_uniforms.setBool("isSnow", m_particleSystem->getParticleType());
+    m_uniforms.setVec3("windDirection", m_particleSystem->getWindDirection());
+    m_uniforms.setVec2("emissionArea", glm::vec2(m_particleSystem->getEmissionAreaWidth(), m_particleSystem->getEmissionAreaHeight()));
+    m_uniforms.setVec3("anchor", m_particleSystem->getAnchor());
+    m_uniforms.setFloat("particleSpeed", m_particleSystem->getParticleSpeed());
+    m_uniforms.setFloat("groundLevel", ParticleSystem::GROUND_LEVEL);
+    m_uniforms.setVec2("heightGridOrigin", m_heightGrid.getOrigin());
+    m_uniforms.setFloat("heightGridSpacing", m_heightGrid.getSpacing());
+    m_uniforms.setFloat("heightGridResolution", m_heightGrid.getResolution());
+    m_uniforms.setBool("useHeightGrid", m_heightGridTexture != 0);
+    m_uniforms.setInt("heightGrid", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_heightGridTexture);
+    m_uniforms.setFloat("spawnHeight", ParticleSystem::SPAWN_HEIGHT);
+    m_uniforms.setUInt("frameSeed", m_gpuParticleFrame++);
+    const glm::vec3& viewDir = m_particleSystem->getViewDirection();
+    m_uniforms.setVec2("viewDirection", glm::vec2(viewDir.x, viewDir.z));
+    m_uniforms.setFloat("emissionViewBias", ParticleSystem::EMISSION_VIEW_BIAS);
+
+    // Vertex stage only; nothing reaches the rasterizer
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(m_gpu_update_vao[m_gpuParticleSrc]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_gpu_particle_vbo[dst]);
+
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, activeCount);
+    countDraw(GL_POINTS, activeCount);
+    glEndTransformFeedback();
+
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
 
-    // Set texture parameters for water texture
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    m_gpuParticleSrc = dst;
+}
 
+void GLRenderer::setWeatherType(bool isSnow) {
+    if (!m_particleSystem) return;  // Guard against null pointer
 
-    // Unbind water texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    makeRendererCurrent();  // Ensure OpenGL context is current
+    m_isSnow = isSnow;
+    m_particleSystem->setParticleType(isSnow);
+    requestFrame();
+    doneRendererCurrent();
+}
 
-    // Load rockSand texture
-    QString rockMiddle_filepath = QString(":/resources/images/rockMiddle.jpg");
-    if (!m_image.load(rockMiddle_filepath)) {
-        std::cerr << "Failed to load texture: " << rockMiddle_filepath.toStdString() << std::endl;
-        return;
+void GLRenderer::bindTerrainTexture() {
+    // Decode, downscale and mipmap everything in parallel (or read it back from the cache)
+    // and upload it on the upload thread, so startup does not wait for it. Terrain is
+    // drawn once the textures are resident.
+    std::vector<QString> paths;
+    for (const auto& entry : TERRAIN_TEXTURES) {
+        paths.push_back(entry.path);
     }
-    m_image = m_image.convertToFormat(QImage::Format_RGBA8888);
-
-    // Generate and bind texture ID for water
-    glGenTextures(1, &m_textureID11);
-    glActiveTexture(GL_TEXTURE10); // Bind to texture unit 4
-    glBindTexture(GL_TEXTURE_2D, m_textureID11);
+    // BC1 cuts memory and sampling bandwidth 8x; the textures are opaque, so nothing is lost to alpha
+    const bool compress = GLEW_EXT_texture_compression_s3tc;
+    const int maxSize = settings.maxTextureSize;
+    auto textures = std::make_shared<std::vector<GLuint>>(paths.size(), 0);
+    auto bytes = std::make_shared<size_t>(0);
+    m_uploader.submit(
+        [paths, compress, maxSize, textures, bytes]() {
+            std::vector<TextureData> data;
+            {
+                TRACE_SCOPE("Load terrain textures");
+                data = TextureLoader(maxSize, compress).loadAll(paths);
+            }
+            for (size_t i = 0; i < data.size(); i++) {
+                (*textures)[i] = uploadTexture(data[i], *bytes);
+            }
+        },
+        [this, textures, bytes]() {
+            for (size_t i = 0; i < textures->size(); i++) {
+                this->*TERRAIN_TEXTURES[i].texture = (*textures)[i];
+            }
+            m_textureBytes += *bytes;
+            m_terrainTexturesReady = true;
+        });
+}
 
-    // Upload water texture data to GPU
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_image.width(), m_image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_image.bits());
-    glGenerateMipmap(GL_TEXTURE_2D);
+// Uploads a prebuilt mip chain, adding its size to bytes; returns 0 if there is nothing to upload
+GLuint GLRenderer::uploadTexture(const TextureData& data, size_t& bytes) {
+    if (data.levels.empty()) return 0;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0; level < data.levels.size(); level++) {
+        const MipLevel& mip = data.levels[level];
+        bytes += mip.pixels.size();
+        if (data.format == TextureData::Format::BC1) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, mip.width, mip.height, 0,
+                mip.pixels.size(), mip.pixels.data());
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    // Set texture parameters for water texture
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.levels.size() - 1);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-
-    // Unbind water texture
     glBindTexture(GL_TEXTURE_2D, 0);
-
-
-
-    glUseProgram(0);
-
+    return texture;
 }
 
 void GLRenderer::renderParticles() {
-    glUseProgram(m_particle_shader);
-    glBindVertexArray(m_particle_vao);
+    m_uniforms.use(m_particle_shader);
+    glBindVertexArray(m_gpuParticles ? m_gpu_render_vao[m_gpuParticleSrc] : m_particle_vao);
 
-    GLint projLoc = glGetUniformLocation(m_particle_shader, "projection");
-    GLint viewLoc = glGetUniformLocation(m_particle_shader, "view");
-    GLint isSnowLoc = glGetUniformLocation(m_particle_shader, "isSnow");
+    m_uniforms.setBool("isSnow", m_particleSystem->getParticleType()); // Lags m_isSnow while a type change fades
 
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, &m_proj[0][0]);
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &m_view[0][0]);
-    glUniform1i(isSnowLoc, m_isSnow);
+    // The CPU stream is already culled and thinned; GPU-resident particles are thinned here
+    m_uniforms.setBool("distanceLod", m_gpuParticles);
+    m_uniforms.setVec3("lodParams", glm::vec3(ParticleSystem::LOD_NEAR, ParticleSystem::LOD_FAR, ParticleSystem::LOD_MIN_KEEP));
+    // Point sizes are in pixels, so they shrink with the render resolution
+    m_uniforms.setFloat("pointScale", m_sceneActive ? m_dynamicResolution.getScale() : 1.0f);
 
     glEnable(GL_POINT_SPRITE);
     glEnable(GL_PROGRAM_POINT_SIZE);
 
-    const auto& particles = m_particleSystem->getParticles();
-    glDrawArrays(GL_POINTS, 0, particles.size());
+    if (m_gpuParticles) {
+        glDrawArrays(GL_POINTS, 0, m_particleSystem->getActiveCount());
+        countDraw(GL_POINTS, m_particleSystem->getActiveCount());
+    }
+    else {
+        glDrawArrays(GL_POINTS, m_particleRegion * m_particleRegionSize, m_particleDrawCount);
+        countDraw(GL_POINTS, m_particleDrawCount);
+
+        // Guard the region against being rewritten while this draw is in flight
+        GLsync& fence = m_particleFences[m_particleRegion];
+        if (fence) glDeleteSync(fence);
+        fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
 
     glDisable(GL_POINT_SPRITE);
     glDisable(GL_PROGRAM_POINT_SIZE);
@@ -633,12 +1025,9 @@ void GLRenderer::constrainCamera() {
 }
 
 // Fix the auto-rotation functionality in updateCameraPosition():
-void GLRenderer::updateCameraPosition() {
+void GLRenderer::updateCameraPosition(float deltaTime) {
     if (!m_autoRotate) return;
 
-    float deltaTime = m_elapsedTimer.elapsed() * 0.001f; // Convert to seconds
-    m_elapsedTimer.restart();
-
     // Update rotation angle
     m_rotationAngle += m_rotationSpeed * deltaTime;
 
@@ -658,22 +1047,132 @@ void GLRenderer::updateCameraPosition() {
 }
 
 
-void GLRenderer::timerEvent(QTimerEvent* event) {
-    float deltaTime = m_elapsedTimer.elapsed() * 0.001f;  // Convert to seconds
+void GLRenderer::onFrameSwapped() {
+    stepSimulation();
+    requestFrame();
+}
+
+// Runs as many fixed steps as wall time allows; the remainder is carried over and used
+// to interpolate the camera when drawing
+void GLRenderer::stepSimulation() {
+    double elapsed = m_elapsedTimer.nsecsElapsed() * 1e-9;
+    m_elapsedTimer.restart();
+    // After a stall (window hidden, breakpoint) resume instead of fast-forwarding
+    m_stepAccumulator += std::min(elapsed, MAX_FRAME_TIME);
+    while (m_stepAccumulator >= SIMULATION_TIME_STEP) {
+        m_prevEye = m_eye;
+        m_prevLook = m_look;
+        if (m_replay) stepReplay();
+        advance(SIMULATION_TIME_STEP);
+        if (m_recording) {
+            m_recordingTime += SIMULATION_TIME_STEP;
+            m_recording->add({m_recordingTime, heldKeys(), m_eye, m_look});
+        }
+        m_stepAccumulator -= SIMULATION_TIME_STEP;
+    }
+}
+
+// Coalesces repaint requests: at most one update() is pending until the frame is painted
+void GLRenderer::requestFrame() {
+    if (m_frameRequested || m_offscreenContext) return;
+    m_frameRequested = true;
+    update();
+}
+
+// For jumps that should not be smoothed over, like mouse look or a camera reset
+void GLRenderer::resetCameraInterpolation() {
+    m_prevEye = m_eye;
+    m_prevLook = m_look;
+}
+
+void GLRenderer::startRecording(const std::string& path) {
+    m_recording = std::make_unique<CameraRecording>();
+    m_recordingPath = path;
+    // Fresh seed per session, stored so the replay sees the same weather
+    uint64_t seed = (uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+    m_recording->setSeed(seed);
+    if (m_particleSystem) {
+        m_particleSystem->seed(seed);
+        m_particleSystem->reset();
+    }
+    m_recordingTime = 0.0f;
+}
+
+bool GLRenderer::startReplay(const std::string& path) {
+    auto replay = std::make_unique<CameraRecording>();
+    if (!replay->load(path)) return false;
+    if (replay->isEmpty()) {
+        std::cerr << "Camera recording " << path << " has no samples" << std::endl;
+        return false;
+    }
+    if (m_particleSystem) {
+        m_particleSystem->seed(replay->getSeed());
+        m_particleSystem->reset();
+    }
+    m_replay = std::move(replay);
+    m_replayTime = 0.0f;
+    return true;
+}
+
+uint32_t GLRenderer::heldKeys() const {
+    static const std::pair<Qt::Key, uint32_t> KEYS[] = {
+        {Qt::Key_W, CameraRecording::KEY_FORWARD}, {Qt::Key_A, CameraRecording::KEY_LEFT},
+        {Qt::Key_S, CameraRecording::KEY_BACK}, {Qt::Key_D, CameraRecording::KEY_RIGHT},
+        {Qt::Key_Space, CameraRecording::KEY_UP}, {Qt::Key_Control, CameraRecording::KEY_DOWN}};
+    uint32_t keys = 0;
+    for (const auto& [key, bit] : KEYS) {
+        auto it = m_keyMap.find(key);
+        if (it != m_keyMap.end() && it->second) keys |= bit;
+    }
+    return keys;
+}
+
+// Moves the camera to the recording's state at the current replay time
+void GLRenderer::stepReplay() {
+    if (m_replayTime > m_replay->getDuration()) {
+        std::cout << "Replay finished: " << m_chunkRequests << " chunk requests, hash "
+                  << std::hex << m_chunkRequestHash << std::dec << std::endl;
+        m_replay.reset();
+        return;
+    }
+    glm::vec3 eye, look;
+    m_replay->cameraAt(m_replayTime, eye, look);
+    setCamera(eye, look);
+    m_replayTime += SIMULATION_TIME_STEP;
+}
+
+// Steps particles, water and camera movement by deltaTime seconds
+void GLRenderer::advance(float deltaTime) {
+    m_waterAnimTime += WATER_ANIM_SPEED * deltaTime;
 
     // Handle particle system updates
-    if (m_weatherEnabled && m_particleSystem) {
-        m_particleSystem->update(deltaTime);
-        glBindBuffer(GL_ARRAY_BUFFER, m_particle_vbo);
-        const auto& particles = m_particleSystem->getParticles();
-        glBufferSubData(GL_ARRAY_BUFFER, 0, particles.size() * sizeof(Particle), particles.data());
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // Keep simulating while a cleared weather is still fading out
+    if (m_particleSystem && (m_weatherEnabled || m_particleSystem->getActiveCount() > 0)) {
+        m_particleSystem->setAnchor(m_eye);
+        glm::vec3 lookDir = m_look - m_eye;
+        m_particleSystem->setViewDirection(lookDir);
+        makeRendererCurrent();
+        {
+            // Ends its GPU query before the context is released
+            FrameProfiler::Scope scope(m_profiler, FrameProfiler::PARTICLE_UPDATE);
+            TRACE_SCOPE("Particle update");
+            updateHeightGrid();
+            if (m_gpuParticles) {
+                // State stays on the GPU; no per-frame CPU work or upload
+                updateGpuParticles(deltaTime);
+            }
+            else {
+                m_particleSystem->update(deltaTime);
+                uploadParticleVertices();
+            }
+        }
+        doneRendererCurrent();
     }
 
     if (m_autoRotate) {
-        updateCameraPosition();
+        updateCameraPosition(deltaTime);
     }
-    else {
+    else if (!m_replay) {
         // Manual WASD movement
         // Calculate movement vectors
         glm::vec3 lookDir = glm::normalize(m_look - m_eye);
@@ -729,136 +1228,231 @@ void GLRenderer::timerEvent(QTimerEvent* event) {
         }
     }
 
-    m_elapsedTimer.restart();
-    update();
+    // Stream terrain per step rather than per paint, so every chunk the camera crosses is
+    // requested even when repaints are coalesced
+    makeRendererCurrent();
+    updateTerrainChunks();
+    doneRendererCurrent();
+}
+
+
+void GLRenderer::initializeSkyLut() {
+    glGenTextures(1, &m_skyLutTexture);
+    glBindTexture(GL_TEXTURE_2D, m_skyLutTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SKY_LUT_WIDTH, SKY_LUT_HEIGHT, 0, GL_RGBA, GL_HALF_FLOAT, nullptr);
+    m_textureBytes += SKY_LUT_WIDTH * SKY_LUT_HEIGHT * 4 * sizeof(uint16_t);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);         // Azimuth wraps around
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_skyLutFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_skyLutFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_skyLutTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Sky LUT framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, renderTarget());
+
+    glGenVertexArrays(1, &m_fullscreen_vao);
 }
 
+// Re-bakes the Preetham model into the LUT when the sun or the turbidity changed
+void GLRenderer::updateSkyLut() {
+    float turbidity = (settings.weather == WeatherType::CLEAR) ? 2.0f : 10.0f;
+    if (m_sunPos == m_skyLutSunPos && turbidity == m_skyLutTurbidity) return;
+    m_skyLutSunPos = m_sunPos;
+    m_skyLutTurbidity = turbidity;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_skyLutFbo);
+    glViewport(0, 0, SKY_LUT_WIDTH, SKY_LUT_HEIGHT);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    m_uniforms.use(m_skylut_shader);
+    m_uniforms.setVec2("sunPosition", m_sunPos);
+    m_uniforms.setFloat("T", turbidity);
+    glBindVertexArray(m_fullscreen_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    countDraw(GL_TRIANGLES, 3);
+    glBindVertexArray(0);
+
+    glEnable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderTarget());
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
 
 void GLRenderer::paintDome() {
+    updateSkyLut();
 
-    glUseProgram(m_skydome_shader);
+    m_uniforms.use(m_skydome_shader);
     glBindVertexArray(m_sphere_vao);
 
     glm::mat4 domeModel = glm::mat4(1.0f);
-    domeModel = glm::translate(domeModel, glm::vec3(m_eye.x, 0, m_eye.z));
+    domeModel = glm::translate(domeModel, glm::vec3(m_renderEye.x, 0, m_renderEye.z));
     domeModel = glm::scale(domeModel, glm::vec3(200, 200, 200));
 
-    GLint modelLoc = glGetUniformLocation(m_skydome_shader, "model");
-    GLint viewLoc = glGetUniformLocation(m_skydome_shader, "view");
-    GLint projLoc = glGetUniformLocation(m_skydome_shader, "projection");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &domeModel[0][0]);
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, &m_view[0][0]);
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, &m_proj[0][0]);
+    m_uniforms.setMat4("model", domeModel);
 
-    glm::vec4 cameraPos = glm::vec4(glm::inverse(m_view)[3]);
-    GLint camPosLoc = glGetUniformLocation(m_skydome_shader, "camPos");
-    glUniform4fv(camPosLoc, 1, &cameraPos[0]);
-
-    GLint sunPosLoc = glGetUniformLocation(m_skydome_shader, "sunPosition");
-    glUniform2fv(sunPosLoc, 1, &m_sunPos[0]);
-
-    GLint tPosLoc = glGetUniformLocation(m_skydome_shader, "T");
-    float turbidity = (settings.weather == WeatherType::CLEAR) ? 2.0f : 10.0f;
-    glUniform1f(tPosLoc, turbidity);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_skyLutTexture);
+    m_uniforms.setInt("skyLut", 0);
 
     glDrawArrays(GL_TRIANGLES, 0, m_sphereData.size() / 3);
+    countDraw(GL_TRIANGLES, m_sphereData.size() / 3);
 
+    glBindTexture(GL_TEXTURE_2D, 0);
     glBindVertexArray(0);
     glUseProgram(0);
 
 }
 
 void GLRenderer::paintTerrain() {
-    glUseProgram(m_terrain_shader);
-    updateTerrainChunks();
-    // Render all visible chunks
-    for (auto& [key, chunk] : m_terrainChunks) {
-        glBindVertexArray(chunk.vao);
-        glm::mat4 model(1.0);
-        glUniformMatrix4fv(glGetUniformLocation(m_terrain_shader, "model"), 1, GL_FALSE, &model[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(m_terrain_shader, "view"), 1, GL_FALSE, &m_view[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(m_terrain_shader, "projection"), 1, GL_FALSE, &m_proj[0][0]);
-
-        glUniform1f(glGetUniformLocation(m_terrain_shader, "transitionWidth"), 0.1f);
-
-        // Bind texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_textureID);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture1"), 0);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, m_textureID2);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture2"), 1);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, m_textureID3);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture3"), 2);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, m_textureID4);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture4"), 3);
-
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, m_textureID6);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture6"), 5);
-        glActiveTexture(GL_TEXTURE6);
-        glBindTexture(GL_TEXTURE_2D, m_textureID7);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture7"), 6);
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, m_textureID8);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture8"), 7);
-        glActiveTexture(GL_TEXTURE8);
-        glBindTexture(GL_TEXTURE_2D, m_textureID9);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture9"), 8);
-
-        glActiveTexture(GL_TEXTURE9);
-        glBindTexture(GL_TEXTURE_2D, m_textureID10);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture10"), 9);
-
-        glActiveTexture(GL_TEXTURE10);
-        glBindTexture(GL_TEXTURE_2D, m_textureID11);
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "texture11"), 10);
-
-
-
-        glUniform1f(glGetUniformLocation(m_terrain_shader, "brightness"), m_brightness);
-        glUniform1f(glGetUniformLocation(m_terrain_shader, "minBrightness"), 0.3f); // Set minimum brightness
-        // Pass alpha to shader
-
-        if (settings.mountain == MountainType::SNOW_MOUNTAIN) {
-            activeTexture = 0;
-        }
-        else if (settings.mountain == MountainType::ROCK_MOUNTAIN) {
-            activeTexture = 1;
-        }
-        else if (settings.mountain == MountainType::GRASS_MOUNTAIN) {
-            activeTexture = 2;
-        }
-
-        glUniform1i(glGetUniformLocation(m_terrain_shader, "activeTexture"), activeTexture);
-        glDrawArrays(GL_TRIANGLES, 0, chunk.vertexCount);
+    updateChunkDrawOrder();
+    // Untextured terrain would flash black until the upload thread delivers the textures
+    if (!m_terrainTexturesReady) return;
+    glm::mat4 model(1.0);
+
+    // Depth-only pass first, then shade with the depth test rejecting everything hidden
+    bool prepass = settings.depthPrepass && m_terrain_depth_shader;
+    if (prepass) {
+        m_uniforms.use(m_terrain_depth_shader);
+        m_uniforms.setMat4("model", model);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        drawTerrainChunks();
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthFunc(GL_LEQUAL);
+        glDepthMask(GL_FALSE);
     }
 
+    m_uniforms.use(m_terrain_shader);
+
+    // Nothing below varies per chunk, so it is set once for the whole pass
+    m_uniforms.setMat4("model", model);
+    m_uniforms.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+    m_uniforms.setFloat("transitionWidth", 0.1f);
+    m_uniforms.setFloat("minBrightness", 0.3f); // Set minimum brightness
+
+    // Bind texture
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_textureID2);
+    m_uniforms.setInt("texture2", 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_textureID3);
+    m_uniforms.setInt("texture3", 2);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, m_textureID4);
+    m_uniforms.setInt("texture4", 3);
+
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D, m_textureID6);
+    m_uniforms.setInt("texture6", 5);
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, m_textureID7);
+    m_uniforms.setInt("texture7", 6);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, m_textureID8);
+    m_uniforms.setInt("texture8", 7);
+    glActiveTexture(GL_TEXTURE8);
+    glBindTexture(GL_TEXTURE_2D, m_textureID9);
+    m_uniforms.setInt("texture9", 8);
+
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_2D, m_textureID10);
+    m_uniforms.setInt("texture10", 9);
+
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_2D, m_textureID11);
+    m_uniforms.setInt("texture11", 10);
+
+    drawTerrainChunks();
+
+    if (prepass) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
     glBindVertexArray(0);
     glUseProgram(0);
 }
 
-void GLRenderer::settingsChanged() {
-    makeCurrent();
-    // Check if this is a weather type change
-    if (m_particleSystem != nullptr &&
-        ((settings.weather == WeatherType::SNOW || settings.weather == WeatherType::RAIN) != m_weatherEnabled ||
-            (settings.weather == WeatherType::SNOW) != m_isSnow)) {
+// Front to back, so near hills fill the depth buffer before the ones they hide
+void GLRenderer::updateChunkDrawOrder() {
+    // Moving less than this barely changes the order; the few misordered chunks only cost overdraw
+    const float resortDistance = TerrainGenerator::CHUNK_SIZE * 0.25f;
+    glm::vec2 moved(m_eye.x - m_chunkDrawOrderEye.x, m_eye.z - m_chunkDrawOrderEye.z);
+    if (!m_chunkDrawOrderDirty && glm::dot(moved, moved) < resortDistance * resortDistance) {
+        return;
+    }
+    m_chunkDrawOrderDirty = false;
+    m_chunkDrawOrderEye = m_eye;
+
+    auto distance2 = [this](const TerrainChunk* chunk) {
+        glm::vec2 center = (glm::vec2(chunk->position) + 0.5f) * TerrainGenerator::CHUNK_SIZE;
+        glm::vec2 offset = center - glm::vec2(m_eye.x, m_eye.z);
+        return glm::dot(offset, offset);
+    };
+    m_chunkDrawOrder.clear();
+    m_chunkDrawOrder.reserve(m_terrainChunks.size());
+    for (const auto& [key, chunk] : m_terrainChunks) {
+        m_chunkDrawOrder.push_back(&chunk);
+    }
+    std::sort(m_chunkDrawOrder.begin(), m_chunkDrawOrder.end(),
+              [&](const TerrainChunk* a, const TerrainChunk* b) { return distance2(a) < distance2(b); });
+}
+
+void GLRenderer::drawTerrainChunks() {
+    for (const TerrainChunk* chunk : m_chunkDrawOrder) {
+        glBindVertexArray(chunk->vao);
+        glDrawArrays(GL_TRIANGLES, 0, chunk->vertexCount);
+        countDraw(GL_TRIANGLES, chunk->vertexCount);
+    }
+}
+
+GLuint GLRenderer::terrainVariant(MountainType mountain) {
+    std::vector<std::string> defines;
+    switch (mountain) {
+    case MountainType::SNOW_MOUNTAIN: defines.push_back("MOUNTAIN_SNOW"); break;
+    case MountainType::ROCK_MOUNTAIN: defines.push_back("MOUNTAIN_ROCK"); break;
+    case MountainType::GRASS_MOUNTAIN: defines.push_back("MOUNTAIN_GRASS"); break;
+    }
+    GLuint program = ShaderLoader::getVariant(":/resources/shaders/terrain.vert", ":/resources/shaders/terrain.frag", defines);
+    m_uniforms.registerProgram(program);
+    return program;
+}
 
-        m_weatherEnabled = (settings.weather == WeatherType::SNOW || settings.weather == WeatherType::RAIN);
+void GLRenderer::settingsChanged() {
+    makeRendererCurrent();
+    if (m_terrain_shader) {
+        m_terrain_shader = terrainVariant(settings.mountain);
+    }
+    // Weather changes ramp the particle count instead of resetting the system
+    m_weatherEnabled = (settings.weather == WeatherType::SNOW || settings.weather == WeatherType::RAIN);
+    if (m_weatherEnabled) {
         m_isSnow = settings.weather == WeatherType::SNOW;
+    }
+    if (m_particleSystem != nullptr) {
         m_particleSystem->setParticleType(m_isSnow);
+        m_particleSystem->setIntensity(m_weatherEnabled ? settings.weatherIntensity : 0.0f);
+    }
+
+    // Switch simulation mode; the GPU path needs a compiled update program
+    bool gpuParticles = settings.gpuParticles && m_particle_update_shader != 0;
+    if (m_particleSystem != nullptr && gpuParticles != m_gpuParticles) {
+        m_gpuParticles = gpuParticles;
+        if (m_gpuParticles) uploadGpuParticles();
     }
+    m_profiler.setEnabled(settings.showProfiler);
     // Update time and view-related settings
     timeToSunPos(settings.time);
     sunPosToBrightness();
     m_fov = settings.fov;
 
     rebuildMatrices();
-    update();
-    doneCurrent();
+    doneRendererCurrent();
 }
 
 void GLRenderer::timeToSunPos(const float time)
@@ -918,6 +1512,7 @@ void GLRenderer::mouseMoveEvent(QMouseEvent* event) {
         // Update look position and up vector
         m_look = m_eye + dir;
 
+        resetCameraInterpolation();
         rebuildMatrices();
     }
     else if (m_mouseDown == MouseStaus::RIGHT) {
@@ -950,6 +1545,7 @@ void GLRenderer::mouseMoveEvent(QMouseEvent* event) {
         // Apply constraints
         constrainCamera();
 
+        resetCameraInterpolation();
         rebuildMatrices();
     }
 }
@@ -986,6 +1582,9 @@ void GLRenderer::wheelEvent(QWheelEvent* event)
 }
 
 void GLRenderer::keyPressEvent(QKeyEvent* event) {
+    if (event->key() == Qt::Key_F12 && !event->isAutoRepeat() && Trace::dump()) {
+        std::cout << "Trace written" << std::endl;
+    }
     if (event->key() == Qt::Key_R && !event->isAutoRepeat()) {
         m_autoRotate = !m_autoRotate;
         if (m_autoRotate) {
@@ -998,7 +1597,7 @@ void GLRenderer::keyPressEvent(QKeyEvent* event) {
             m_eye = glm::vec3(m_trajectoryRadius, m_trajectoryHeight, 0.0f);
             m_look = glm::vec3(0.0f, 0.0f, 0.0f);
             m_up = glm::vec3(0.0f, 1.0f, 0.0f);
-            m_elapsedTimer.restart();
+            resetCameraInterpolation();
         }
     }
     m_keyMap[Qt::Key(event->key())] = true;
@@ -1013,14 +1612,14 @@ void GLRenderer::rebuildMatrices()
 {
     // Update view matrix by rotating eye vector based on x and y angles
     m_view = glm::lookAt(m_eye, m_look, m_up);
-    m_proj = glm::perspective(glm::radians(m_fov), 1.0f * width() / height(), 0.01f, 1000.0f);
-    update();
+    m_proj = glm::perspective(glm::radians(m_fov), 1.0f * renderWidth() / renderHeight(), 0.01f, 1000.0f);
+    requestFrame();
 }
 
 void GLRenderer::addChunkIfNeeded(int x, int z, int priority, 
     std::vector<std::pair<int, std::pair<int, int>>>& chunks) {
     int64_t key = getChunkKey(x, z);
-    if (m_terrainChunks.find(key) == m_terrainChunks.end()) {
+    if (m_terrainChunks.find(key) == m_terrainChunks.end() && !m_requestedChunks.count(key)) {
         chunks.push_back({priority, {x, z}});
     }
 }
@@ -1051,6 +1650,20 @@ void GLRenderer::updateTerrainChunks(bool force) {
             glDeleteBuffers(1, &it->second.vbo);
             glDeleteVertexArrays(1, &it->second.vao);
             it = m_terrainChunks.erase(it);
+            m_chunkDrawOrderDirty = true;
+        } else {
+            ++it;
+        }
+    }
+
+    // Requests that left the range are cancelled; any already being generated are
+    // discarded on arrival
+    m_terrainQueue->cancelOutside(minX, maxX, minZ, maxZ);
+    for (auto it = m_requestedChunks.begin(); it != m_requestedChunks.end();) {
+        int chunkX = static_cast<int>(*it >> 32);
+        int chunkZ = static_cast<int>(static_cast<uint32_t>(*it));
+        if (chunkX < minX || chunkX > maxX || chunkZ < minZ || chunkZ > maxZ) {
+            it = m_requestedChunks.erase(it);
         } else {
             ++it;
         }
@@ -1061,10 +1674,7 @@ void GLRenderer::updateTerrainChunks(bool force) {
         // Only process the perimeter of each layer
         if (layer == 0) {
             // Center chunk
-            int64_t key = getChunkKey(currentChunkX, currentChunkZ);
-            if (m_terrainChunks.find(key) == m_terrainChunks.end()) {
-                chunksToLoad.push_back({0, {currentChunkX, currentChunkZ}});
-            }
+            addChunkIfNeeded(currentChunkX, currentChunkZ, 0, chunksToLoad);
             continue;
         }
 
@@ -1083,9 +1693,20 @@ void GLRenderer::updateTerrainChunks(bool force) {
     }
 
     std::sort(chunksToLoad.begin(), chunksToLoad.end());
-    for (const auto& chunk : chunksToLoad) {
-        m_terrainQueue->addChunk(chunk.second.first, chunk.second.second);
+    {
+        TRACE_SCOPE("Chunk enqueue");
+        // Each chunk is requested once until it arrives or leaves the range, so the request
+        // sequence depends only on the camera path, not on how fast the worker keeps up.
+        // Refused requests are not recorded, so a later pass asks again.
+        for (const auto& chunk : chunksToLoad) {
+            if (!m_terrainQueue->addChunk(chunk.second.first, chunk.second.second)) continue;
+            int64_t key = getChunkKey(chunk.second.first, chunk.second.second);
+            m_requestedChunks.insert(key);
+            m_chunkRequestHash = (m_chunkRequestHash ^ static_cast<uint64_t>(key)) * 1099511628211ull;  // FNV-1a
+            m_chunkRequests++;
+        }
     }
+    TRACE_COUNTER("Resident chunks", m_terrainChunks.size());
 
     // Update water planes
    updateWaterPlanesOptimized(currentChunkX, currentChunkZ);
@@ -1157,35 +1778,25 @@ void GLRenderer::createWaterPlaneIfNeeded(int x, int z) {
 }
 
 void GLRenderer::paintWaterPlanes() {
-    glUseProgram(m_water_shader);
+    m_uniforms.use(m_water_shader);
 
     // Enable blending for transparency
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Update animation time
-    m_waterAnimTime += 0.01f;
-
-    // Calculate effective brightness for water (same as terrain)
-    float effectiveBrightness = std::max(m_brightness, 0.3f);  // Using same minimum brightness as terrain
-
-    // Set all uniform values
-    glUniform1f(glGetUniformLocation(m_water_shader, "time"), m_waterAnimTime);
-    glUniform1f(glGetUniformLocation(m_water_shader, "dispStrength"), 0.5f);
-    glUniform1f(glGetUniformLocation(m_water_shader, "brightness"), effectiveBrightness);
-    glUniform1f(glGetUniformLocation(m_water_shader, "minBrightness"), 0.3f);
+    // Set all uniform values; time and brightness come from the frame block
+    m_uniforms.setFloat("dispStrength", 0.5f);
+    m_uniforms.setFloat("minBrightness", 0.3f);  // Same minimum brightness as terrain
 
     // Create and set model matrix with water level
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.0f, m_waterLevel, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(m_water_shader, "model"), 1, GL_FALSE, &model[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_water_shader, "view"), 1, GL_FALSE, &m_view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_water_shader, "projection"), 1, GL_FALSE, &m_proj[0][0]);
+    m_uniforms.setMat4("model", model);
 
     // Set water displacement texture
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, m_water_disp_texture);
-    glUniform1i(glGetUniformLocation(m_water_shader, "dispTexture"), 0);
+    m_uniforms.setInt("dispTexture", 0);
 
     // Render all water planes
     for (const auto& [key, plane] : m_waterPlanes) {
@@ -1198,10 +1809,11 @@ void GLRenderer::paintWaterPlanes() {
             std::min(plane.fadeTimer.elapsed() / 2000.0f, 1.0f) :
             std::max(1.0f - plane.fadeTimer.elapsed() / 2000.0f, 0.0f);
 
-        glUniform1f(glGetUniformLocation(m_water_shader, "alpha"), alpha);
+        m_uniforms.setFloat("alpha", alpha);
 
         glBindVertexArray(plane.vao);
         glDrawArrays(GL_TRIANGLES, 0, plane.vertexCount);
+        countDraw(GL_TRIANGLES, plane.vertexCount);
     }
 
     // Clean up state
@@ -1230,7 +1842,7 @@ void GLRenderer::createWaterPlane(int chunkX, int chunkZ) {
     );
 
     // Generate geometry data
-    std::vector<float> waterData = generateWaterPlaneData(worldPos);
+    std::vector<float> waterData = TerrainGenerator::generateWaterPlane(worldPos);
     plane.vertexCount = waterData.size() / 5;
 
     // Create and setup OpenGL buffers
@@ -1254,93 +1866,49 @@ void GLRenderer::createWaterPlane(int chunkX, int chunkZ) {
     m_waterPlanes[key] = plane;
 }
 
-std::vector<float> GLRenderer::generateWaterPlaneData(const glm::dvec2& position) {
-    std::vector<float> data;
-    float chunkSize = TerrainGenerator::CHUNK_SIZE;
-    int verticesPerSide = static_cast<int>(chunkSize / TerrainGenerator::VERTEX_SPACING);
-
-    float overlap = TerrainGenerator::VERTEX_SPACING * 0.5f;
-
-    // Pre-allocate memory for better performance
-    data.reserve(verticesPerSide * verticesPerSide * 30);
-
-    for (int x = 0; x < verticesPerSide; x++) {
-        for (int z = 0; z < verticesPerSide; z++) {
-            // Calculate exact world positions
-            float x1 = position.x + x * TerrainGenerator::VERTEX_SPACING;
-            float x2 = position.x + (x + 1) * TerrainGenerator::VERTEX_SPACING;
-            float z1 = position.y + z * TerrainGenerator::VERTEX_SPACING;
-            float z2 = position.y + (z + 1) * TerrainGenerator::VERTEX_SPACING;
-
-            // Calculate UV coordinates
-            float u1 = static_cast<float>(x) / verticesPerSide;
-            float u2 = static_cast<float>(x + 1) / verticesPerSide;
-            float v1 = static_cast<float>(z) / verticesPerSide;
-            float v2 = static_cast<float>(z + 1) / verticesPerSide;
-
-            // First triangle
-            data.push_back(x1);
-            data.push_back(0.0f);  // Water height will be set by model matrix
-            data.push_back(z1);
-            data.push_back(u1);
-            data.push_back(v1);
-
-            data.push_back(x2);
-            data.push_back(0.0f);
-            data.push_back(z1);
-            data.push_back(u2);
-            data.push_back(v1);
-
-            data.push_back(x2);
-            data.push_back(0.0f);
-            data.push_back(z2);
-            data.push_back(u2);
-            data.push_back(v2);
-
-            // Second triangle
-            data.push_back(x1);
-            data.push_back(0.0f);
-            data.push_back(z1);
-            data.push_back(u1);
-            data.push_back(v1);
-
-            data.push_back(x2);
-            data.push_back(0.0f);
-            data.push_back(z2);
-            data.push_back(u2);
-            data.push_back(v2);
-
-            data.push_back(x1);
-            data.push_back(0.0f);
-            data.push_back(z2);
-            data.push_back(u1);
-            data.push_back(v2);
-        }
+void GLRenderer::handleChunkReady(const TerrainGenerationQueue::ChunkData& chunk) {
+    // Cancelled while it was being generated. The key stays requested until the upload
+    // finishes, so the chunk is not asked for again in the meantime.
+    int64_t key = getChunkKey(chunk.chunkX, chunk.chunkZ);
+    if (!m_requestedChunks.count(key)) {
+        return;
     }
 
-    return data;
+    // The buffer is filled on the upload thread; VAOs are not shared between contexts, so
+    // the vertex layout is set up on completion
+    auto vertices = std::make_shared<std::vector<float>>(chunk.terrainData);
+    auto vbo = std::make_shared<GLuint>(0);
+    glm::ivec2 position(chunk.chunkX, chunk.chunkZ);
+    int vertexCount = chunk.vertexCount;
+    m_uploader.submit(
+        [vertices, vbo]() {
+            glGenBuffers(1, vbo.get());
+            glBindBuffer(GL_ARRAY_BUFFER, *vbo);
+            glBufferData(GL_ARRAY_BUFFER, vertices->size() * sizeof(float), vertices->data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        },
+        [this, key, position, vertexCount, vbo]() {
+            finishChunkUpload(key, position, vertexCount, *vbo);
+        });
 }
 
-void GLRenderer::handleChunkReady(const TerrainGenerationQueue::ChunkData& chunk) {
-    // Make sure we have an OpenGL context
-    makeCurrent();
+void GLRenderer::finishChunkUpload(int64_t key, const glm::ivec2& position, int vertexCount, GLuint vbo) {
+    // Left the render range while uploading
+    if (!m_requestedChunks.erase(key)) {
+        glDeleteBuffers(1, &vbo);
+        return;
+    }
 
     // Create new terrain chunk
     TerrainChunk terrainChunk;
-    terrainChunk.position = glm::ivec2(chunk.chunkX, chunk.chunkZ);
-    terrainChunk.vertexCount = chunk.vertexCount;
-
-    // Generate OpenGL buffers
+    terrainChunk.position = position;
+    terrainChunk.vertexCount = vertexCount;
+    terrainChunk.vbo = vbo;
     glGenVertexArrays(1, &terrainChunk.vao);
-    glGenBuffers(1, &terrainChunk.vbo);
 
-    // Bind and upload data
+    // Bind the uploaded buffer to the new VAO
     glBindVertexArray(terrainChunk.vao);
     glBindBuffer(GL_ARRAY_BUFFER, terrainChunk.vbo);
-    glBufferData(GL_ARRAY_BUFFER,
-        chunk.terrainData.size() * sizeof(float),
-        chunk.terrainData.data(),
-        GL_STATIC_DRAW);
 
     // Set up vertex attributes
     // Position attribute
@@ -1366,9 +1934,6 @@ void GLRenderer::handleChunkReady(const TerrainGenerationQueue::ChunkData& chunk
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    // Store the chunk
-    int64_t key = getChunkKey(chunk.chunkX, chunk.chunkZ);
-
     // If there's an existing chunk, clean it up first
     auto existingChunk = m_terrainChunks.find(key);
     if (existingChunk != m_terrainChunks.end()) {
@@ -1377,9 +1942,5 @@ void GLRenderer::handleChunkReady(const TerrainGenerationQueue::ChunkData& chunk
     }
 
     m_terrainChunks[key] = terrainChunk;
-
-    // Request a redraw
-    update();
-
-    doneCurrent();
+    m_chunkDrawOrderDirty = true;
 }
@@ -9,12 +9,25 @@
 #include <QElapsedTimer>
 #include <QKeyEvent>
 #include <QMouseEvent>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
 #include "glm/glm.hpp"
 #include "utils/camera.h"
 #include "utils/terrain.h"
 #include "utils/particle.h"
+#include "utils/heightGrid.h"
+#include "utils/textureLoader.h"
+#include "settings.h"
 #include "utils/terrainQueue.h"
+#include "utils/managers/uniformmanager.h"
+#include "utils/frameProfiler.h"
+#include "utils/dynamicResolution.h"
+#include "utils/uploadThread.h"
+#include "utils/rendererStats.h"
+#include "utils/cameraRecording.h"
 #include <memory>
+#include <cstdint>
+#include <unordered_set>
 
 QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
 
@@ -32,6 +45,21 @@ public:
     void settingsChanged();
     void setWeatherType(bool isSnow);
     void setWeatherEnabled(bool enabled) { m_weatherEnabled = enabled; }
+    // Workload of the last completed frame
+    const RendererStats& getStats() const { return m_stats; }
+
+    // Headless operation for benchmarks: renders into an offscreen framebuffer, the
+    // widget is never shown and the frame loop never runs
+    bool initializeHeadless(int width, int height, uint64_t seed);
+    void renderHeadlessFrame(float deltaTime);
+    void setCamera(const glm::vec3& eye, const glm::vec3& look);
+    bool isTerrainComplete() const;
+    void requestMissingChunks();
+
+    // Records the camera and movement keys until the renderer is destroyed, then saves them
+    void startRecording(const std::string& path);
+    // Flies a recording at a fixed timestep with its particle seed; stops at the end
+    bool startReplay(const std::string& path);
     ~GLRenderer();
 
 protected:
@@ -47,24 +75,98 @@ protected:
     void wheelEvent(QWheelEvent* e) override;
     void keyPressEvent(QKeyEvent* event) override;
     void keyReleaseEvent(QKeyEvent* event) override;
-    void timerEvent(QTimerEvent* event) override;
     void rebuildMatrices();
     void timeToSunPos(const float time);
 
-public slots:
-    void tick(QTimerEvent* event);
-
 private slots:
     void handleChunkReady(const TerrainGenerationQueue::ChunkData& chunk);
 
 private:
+    // The widget's context and framebuffer, or the offscreen ones when headless
+    void makeRendererCurrent();
+    void doneRendererCurrent();
+    void deleteProgram(GLuint& program);
+    GLuint renderTarget();   // Where the scene passes draw, the scaled target when in use
+    GLuint outputTarget();   // The window or headless framebuffer
+    int renderWidth() const;
+    int renderHeight() const;
+    std::unique_ptr<QOffscreenSurface> m_offscreenSurface;
+    std::unique_ptr<QOpenGLContext> m_offscreenContext;
+    GLuint m_offscreenFbo = 0;
+    GLuint m_offscreenRenderbuffers[2] = {0, 0};  // Color, depth-stencil
+    glm::ivec2 m_offscreenSize = glm::ivec2(0);
+
+    void advance(float deltaTime);
     void initializeParticleSystem();
+    void initializeGpuParticles();
+    void uploadGpuParticles(size_t first = 0, size_t count = SIZE_MAX);
+    void uploadParticleVertices();
+    void updateGpuParticles(float deltaTime);
+    void updateHeightGrid();
     void updateParticles(float deltaTime);
     void renderParticles();
     void bindTerrainVaoVbo();
     void paintTerrain();
     void paintDome();
     void sunPosToBrightness();
+    void updateFrameData();
+
+    // Per-pass timings, shown as an overlay while enabled
+    FrameProfiler m_profiler;
+    void paintProfilerOverlay();
+
+    // Dynamic resolution: the scene is drawn into the lower-left part of an output-sized
+    // target, as large as the GPU time budget allows, then upscaled and sharpened
+    DynamicResolution m_dynamicResolution;
+    GLuint m_upscale_shader = 0;
+    GLuint m_sceneFbo = 0;
+    GLuint m_sceneColor = 0;          // Texture
+    GLuint m_sceneDepth = 0;          // Depth-stencil renderbuffer
+    glm::ivec2 m_sceneSize = glm::ivec2(0);      // Allocated size, that of the output
+    glm::ivec2 m_sceneViewport = glm::ivec2(0);  // Part drawn this frame
+    bool m_sceneActive = false;       // Scene passes are drawing into m_sceneFbo
+    void resizeSceneTarget(const glm::ivec2& size);
+    void upscaleScene();
+
+    // Statistics; draws are counted as they are issued and folded in at the end of a frame
+    RendererStats m_stats;
+    StatsLogger m_statsLogger;
+    uint32_t m_drawCalls = 0;
+    uint64_t m_triangles = 0;
+    size_t m_fixedBufferBytes = 0;  // Buffers allocated once, chunks and water planes are summed per frame
+    size_t m_textureBytes = 0;
+    void countDraw(GLenum mode, GLsizei count) {
+        m_drawCalls++;
+        if (mode == GL_TRIANGLES) m_triangles += count / 3;
+    }
+    void updateStats();
+
+    // Frame loop: every buffer swap steps the simulation at a fixed rate and requests the
+    // next frame, which draws the camera interpolated between the last two steps
+    static constexpr float SIMULATION_TIME_STEP = 1.0f / 60.0f;
+    static constexpr double MAX_FRAME_TIME = 0.25;  // Longest wall time simulated per frame
+    static constexpr float WATER_ANIM_SPEED = 0.6f; // Water animation time per second
+    double m_stepAccumulator = 0.0;                 // Simulated time owed, less than one step after stepping
+    bool m_frameRequested = false;
+    glm::vec3 m_prevEye = glm::vec3(0.0f);          // Camera before the latest step
+    glm::vec3 m_prevLook = glm::vec3(0.0f);
+    glm::vec3 m_renderEye = glm::vec3(0.0f);        // Camera of the frame being drawn
+    void onFrameSwapped();
+    void stepSimulation();
+    void requestFrame();
+    void resetCameraInterpolation();
+
+    // Camera recording and fixed-step replay
+    std::unique_ptr<CameraRecording> m_recording;
+    std::string m_recordingPath;
+    float m_recordingTime = 0.0f;
+    std::unique_ptr<CameraRecording> m_replay;
+    float m_replayTime = 0.0f;
+    uint32_t heldKeys() const;
+    void stepReplay();
+
+    // Uniform locations and last-set values for every program drawn by this renderer
+    UniformManager m_uniforms;
 
 
 
@@ -77,6 +179,33 @@ private:
     bool m_isSnow = true;
     bool m_weatherEnabled = true;
 
+    // CPU particle render stream: a ring of buffer regions guarded by fences
+    static const int PARTICLE_BUFFER_REGIONS = 3;
+    GLsync m_particleFences[PARTICLE_BUFFER_REGIONS] = {};
+    ParticleVertex* m_particleMapped = nullptr;  // Persistent mapping, when GL_ARB_buffer_storage is available
+    size_t m_particleRegionSize = 0;             // Vertices per region
+    int m_particleRegion = 0;                    // Region holding the latest upload
+    GLsizei m_particleDrawCount = 0;
+
+    // GPU particle simulation: state ping-pongs between two buffers via transform feedback
+    struct GpuParticle {
+        glm::vec3 position;
+        glm::vec3 velocity;
+        float size;
+        float life;
+    };
+    GLuint m_particle_update_shader = 0;
+    GLuint m_gpu_particle_vbo[2] = {0, 0};
+    GLuint m_gpu_update_vao[2] = {0, 0};  // Reads simulation state from the matching vbo
+    GLuint m_gpu_render_vao[2] = {0, 0};  // Feeds particle.vert from the matching vbo
+    int m_gpuParticleSrc = 0;             // Buffer holding the latest state
+    uint32_t m_gpuParticleFrame = 0;      // Seeds respawn randomness in the update shader
+    bool m_gpuParticles = false;
+
+    // Terrain heights around the camera that both particle paths collide against
+    HeightGrid m_heightGrid;
+    GLuint m_heightGridTexture = 0;  // R32F copy of m_heightGrid for the update shader
+
     // OpenGL objects
     GLuint m_skydome_shader;
     GLuint m_sphere_vbo;
@@ -84,6 +213,18 @@ private:
     std::vector<float> m_sphereData;
     glm::vec2 m_sunPos;
 
+    // Sky baked into a view-direction LUT, re-rendered only when its inputs change
+    static const int SKY_LUT_WIDTH = 128;   // Azimuth
+    static const int SKY_LUT_HEIGHT = 64;   // Zenith angle
+    GLuint m_skylut_shader = 0;
+    GLuint m_skyLutTexture = 0;
+    GLuint m_skyLutFbo = 0;
+    GLuint m_fullscreen_vao = 0;            // Empty; fullscreen.vert generates its vertices
+    glm::vec2 m_skyLutSunPos = glm::vec2(-1.0f);
+    float m_skyLutTurbidity = -1.0f;
+    void initializeSkyLut();
+    void updateSkyLut();
+
     // transformation matrices
     glm::mat4 m_view = glm::mat4(1);
     glm::mat4 m_proj = glm::mat4(1);
@@ -93,7 +234,6 @@ private:
     QElapsedTimer m_elapsedTimer;
     MouseStaus m_mouseDown = MouseStaus::NONE;
     std::unordered_map<Qt::Key, bool> m_keyMap;
-    int m_timer;
     // Camera trajectory parameters
     bool m_autoRotate = false;
     float m_trajectoryRadius = 30.0f;    // Radius of circular path
@@ -102,7 +242,7 @@ private:
     const float m_rotationSpeed = 0.2f;   // Speed of rotation in radians/second
     const float m_maxHeight = 45.0f;      // Maximum camera height
     const float m_minHeight = 0.5f;       // Minimum camera height
-    void updateCameraPosition();
+    void updateCameraPosition(float deltaTime);
     void constrainCamera();
 
     // camera parameters
@@ -142,42 +282,63 @@ private:
 
     std::unordered_map<int64_t, TerrainChunk> m_terrainChunks;
     glm::ivec2 m_prevCamChunk; // chunk where the camera previously sits
+    // Requested chunks not yet resident. Each chunk is requested once until it arrives or
+    // leaves the range, and every request is folded into a running FNV-1a hash
+    std::unordered_set<int64_t> m_requestedChunks;
+    uint64_t m_chunkRequests = 0;
+    uint64_t m_chunkRequestHash = 14695981039346656037ull;
 
     void updateTerrainChunks(bool force = false);
     void addChunkIfNeeded(int x, int z, int priority, std::vector<std::pair<int, std::pair<int, int>>>& chunks);
     void createChunk(int chunkX, int chunkZ);
+    // Render-thread half of a chunk upload, once its buffer is on the GPU
+    void finishChunkUpload(int64_t key, const glm::ivec2& position, int vertexCount, GLuint vbo);
     int64_t getChunkKey(int chunkX, int chunkZ) {
         return (static_cast<int64_t>(chunkX) << 32) | static_cast<uint32_t>(chunkZ);
     }
-    GLuint m_terrain_shader;
+    GLuint m_terrain_shader = 0;  // Variant for the current mountain type, owned by ShaderLoader
+    GLuint m_terrain_depth_shader = 0;  // terrain.vert with an empty fragment stage
+    // Resident chunks nearest first; rebuilt when chunks change or the camera moves far enough
+    std::vector<const TerrainChunk*> m_chunkDrawOrder;
+    glm::vec3 m_chunkDrawOrderEye = glm::vec3(0.0f);
+    bool m_chunkDrawOrderDirty = true;
+    void updateChunkDrawOrder();
+    void drawTerrainChunks();
+    GLuint terrainVariant(MountainType mountain);
     GLuint m_terrainVao;
     GLuint m_terrainVbo;
     std::vector<GLfloat> m_terrainData;
     TerrainGenerator m_terrain;
     void bindTerrainTexture();
-    QImage m_image;
-    GLuint m_textureID; //snow
-    GLuint m_textureID2;//rock
-    GLuint m_textureID3;//grass
-    GLuint m_textureID4;//sand
-    GLuint m_textureID5;//water
-    GLuint m_textureID6;//snowTop
-    GLuint m_textureID7;//snowSand
-    GLuint m_textureID8;//grassTop
-    GLuint m_textureID9;//rockSend
-    GLuint m_textureID10;//seafloor
-    GLuint m_textureID11;//rockMiddle
+    static GLuint uploadTexture(const TextureData& data, size_t& bytes);
+    // Chunk buffers and terrain textures are created here, off the render thread
+    UploadThread m_uploader;
+    bool m_terrainTexturesReady = false;
+    struct TextureSlot {
+        const char* path;
+        GLuint GLRenderer::* texture;
+    };
+    static const int TERRAIN_TEXTURE_COUNT = 9;
+    static const TextureSlot TERRAIN_TEXTURES[TERRAIN_TEXTURE_COUNT];
+    GLuint m_textureID2 = 0;//rock
+    GLuint m_textureID3 = 0;//grass
+    GLuint m_textureID4 = 0;//sand
+    GLuint m_textureID6 = 0;//snowTop
+    GLuint m_textureID7 = 0;//snowSand
+    GLuint m_textureID8 = 0;//grassTop
+    GLuint m_textureID9 = 0;//rockSend
+    GLuint m_textureID10 = 0;//seafloor
+    GLuint m_textureID11 = 0;//rockMiddle
     void bindTexture();
     int textureLocation;
     float m_brightness;
 
 
     // Water rendering related
-    GLuint m_water_shader;     // Shader program for water
+    GLuint m_water_shader = 0;  // Shader program for water
     GLuint m_water_disp_texture;  // Displacement map texture
     float m_water_time;           // For animation
     QImage m_disp_image;          // Store displacement map image
-    int activeTexture = 0;
     std::unordered_map<int64_t, WaterPlane> m_waterPlanes;
     float m_waterLevel = 0.02f;  // Match with TerrainGenerator
     float m_waterAnimTime = 0.0f;
@@ -188,8 +349,9 @@ private:
     void createWaterPlane(int chunkX, int chunkZ);
     void updateWaterPlanes();
     void paintWaterPlanes();
-    std::vector<float> generateWaterPlaneData(const glm::dvec2& position);
 
     static const int RENDER_DISTANCE = 20;        // Distance for terrain generation
     static const int WATER_RENDER_DISTANCE = 10;  // Distance for water plane generation, smaller than terrain
+    static constexpr float PARTICLE_VOLUME_SIZE = 200.0f;  // Width of the camera-centred precipitation volume
+    static constexpr float UPSCALE_SHARPNESS = 0.6f;  // Unsharp mask strength at the lowest render scale
 };
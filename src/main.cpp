@@ -1,8 +1,13 @@
 #include "mainwindow.h"
+#include "benchmark.h"
 
 #include <QApplication>
 #include <QScreen>
+#include <QCommandLineParser>
 #include <iostream>
+#include <algorithm>
+#include "settings.h"
+#include "utils/trace.h"
 
 int main(int argc, char *argv[])
 {
@@ -12,12 +17,63 @@ int main(int argc, char *argv[])
     QCoreApplication::setOrganizationName("CS 1230");
     QCoreApplication::setApplicationVersion(QT_VERSION_STR);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption textureSizeOption("max-texture-size",
+        "Downscale textures so their longer side is at most <pixels>.", "pixels",
+        QString::number(settings.maxTextureSize));
+    parser.addOption(textureSizeOption);
+    QCommandLineOption traceOption("trace",
+        "Record a Chrome trace of the render and worker threads and write it to <file> "
+        "on exit or when F12 is pressed.", "file");
+    parser.addOption(traceOption);
+    QCommandLineOption statsOption("stats",
+        "Log renderer statistics as CSV to <file>, or to stdout if <file> is -.", "file");
+    parser.addOption(statsOption);
+    QCommandLineOption statsIntervalOption("stats-interval",
+        "Milliseconds between rows of the statistics log.", "ms",
+        QString::number(settings.statsLogInterval));
+    parser.addOption(statsIntervalOption);
+    QCommandLineOption recordOption("record",
+        "Record the camera and movement keys, written to <file> on exit.", "file");
+    parser.addOption(recordOption);
+    QCommandLineOption replayOption("replay",
+        "Fly the camera recording in <file> at a fixed timestep, overriding the controls.", "file");
+    parser.addOption(replayOption);
+    QCommandLineOption benchmarkOption("benchmark",
+        "Run the camera flight in <script> headless and exit.", "script");
+    parser.addOption(benchmarkOption);
+    QCommandLineOption framesOption("frames",
+        "Number of frames to render in benchmark mode, overrides the script.", "count", "0");
+    parser.addOption(framesOption);
+    QCommandLineOption benchmarkOutputOption("benchmark-output",
+        "Where benchmark mode writes its JSON results.", "file", "benchmark-results.json");
+    parser.addOption(benchmarkOutputOption);
+    parser.process(a);
+    settings.maxTextureSize = std::max(1, parser.value(textureSizeOption).toInt());
+    settings.statsLogPath = parser.value(statsOption).toStdString();
+    settings.statsLogInterval = std::max(1, parser.value(statsIntervalOption).toInt());
+    settings.recordPath = parser.value(recordOption).toStdString();
+    settings.replayPath = parser.value(replayOption).toStdString();
+    if (parser.isSet(traceOption)) {
+        Trace::enable(parser.value(traceOption).toStdString());
+        Trace::setThreadName("Render");
+    }
+
     // Set OpenGL version to 4.1 and context to Core
     QSurfaceFormat fmt;
     fmt.setVersion(4, 1);
     fmt.setProfile(QSurfaceFormat::CoreProfile);
     QSurfaceFormat::setDefaultFormat(fmt);
 
+    if (parser.isSet(benchmarkOption)) {
+        Benchmark benchmark(parser.value(benchmarkOption), parser.value(framesOption).toInt(),
+                            parser.value(benchmarkOutputOption));
+        int result = benchmark.run();
+        Trace::dump();
+        return result;
+    }
+
     MainWindow w;
     // w.resize(w.sizeHint());
     w.resize(2000, 1080);
@@ -30,5 +86,7 @@ int main(int argc, char *argv[])
         w.showMaximized();
     }
 
-    return a.exec();
+    int result = a.exec();
+    Trace::dump();
+    return result;
 }
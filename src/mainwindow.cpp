@@ -60,6 +60,8 @@ MainWindow::MainWindow() : QWidget(nullptr), glRenderer(nullptr)
 
     // Create and add mountain controls
     createMountainControls();
+    createProfilerControls();
+    createResolutionControls();
 
     // Connect all UI elements
     connectUIElements();
@@ -82,6 +84,8 @@ void MainWindow::initSettings()
     } else if (rainButton->isChecked()) {
         settings.weather = WeatherType::RAIN;
     }
+    settings.gpuParticles = gpuParticlesBox->isChecked();
+    settings.weatherIntensity = intensitySlider->value() / 100.0f;
 
     if (snowMountainButton->isChecked()) {
         settings.mountain = MountainType::SNOW_MOUNTAIN;
@@ -90,6 +94,10 @@ void MainWindow::initSettings()
     } else {
         settings.mountain = MountainType::GRASS_MOUNTAIN;
     }
+    settings.depthPrepass = depthPrepassBox->isChecked();
+    settings.showProfiler = profilerBox->isChecked();
+    settings.dynamicResolution = dynamicResolutionBox->isChecked();
+    settings.targetFrameMs = targetFrameBox->value();
 }
 
 void MainWindow::createWeatherControls() {
@@ -108,9 +116,22 @@ void MainWindow::createWeatherControls() {
 
     snowButton->setChecked(true);
 
+    gpuParticlesBox = new QCheckBox("GPU Simulation", this);
+    gpuParticlesBox->setChecked(false);
+
+    // Intensity scales how many particles are simulated and drawn
+    QLabel *intensity_label = new QLabel("Intensity:", this);
+    QHBoxLayout *lintensity = new QHBoxLayout();
+    createSliderSpinbox(intensitySlider, intensityBox, 0, 100, 100);
+    lintensity->addWidget(intensitySlider);
+    lintensity->addWidget(intensityBox);
+
     weatherLayout->addWidget(noWeatherButton);
     weatherLayout->addWidget(snowButton);
     weatherLayout->addWidget(rainButton);
+    weatherLayout->addWidget(intensity_label);
+    weatherLayout->addLayout(lintensity);
+    weatherLayout->addWidget(gpuParticlesBox);
 
     vLayout->addWidget(weather_label);
     vLayout->addWidget(weatherBox);
@@ -128,6 +149,29 @@ void MainWindow::setupWeatherControls() {
     connect(snowButton, &QRadioButton::toggled,
             this, &MainWindow::onWeatherTypeChanged,
             Qt::ConnectionType::QueuedConnection);
+    connect(intensitySlider, &QSlider::valueChanged,
+            this, &MainWindow::onValChangeIntensity);
+    connect(intensityBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeIntensity);
+    connect(gpuParticlesBox, &QCheckBox::toggled,
+            this, &MainWindow::onGpuParticlesChanged,
+            Qt::ConnectionType::QueuedConnection);
+}
+
+void MainWindow::onValChangeIntensity(int newValue) {
+    if (!intensitySlider || !intensityBox) return;
+
+    intensitySlider->setValue(newValue);
+    intensityBox->setValue(newValue);
+    settings.weatherIntensity = intensitySlider->value() / 100.0f;
+    if (glRenderer) glRenderer->settingsChanged();
+}
+
+void MainWindow::onGpuParticlesChanged() {
+    if (!glRenderer) return;
+
+    settings.gpuParticles = gpuParticlesBox->isChecked();
+    glRenderer->settingsChanged();
 }
 
 void MainWindow::onWeatherTypeChanged() {
@@ -219,9 +263,13 @@ void MainWindow::createMountainControls() {
 
     snowMountainButton->setChecked(true);
 
+    depthPrepassBox = new QCheckBox("Depth Prepass", this);
+    depthPrepassBox->setChecked(false);
+
     mountainLayout->addWidget(snowMountainButton);
     mountainLayout->addWidget(rockMountainButton);
     mountainLayout->addWidget(grassMountainButton);
+    mountainLayout->addWidget(depthPrepassBox);
 
     vLayout->addWidget(mountain_label);
     vLayout->addWidget(mountainBox);
@@ -239,6 +287,9 @@ void MainWindow::setupMountainControls() {
     connect(grassMountainButton, &QRadioButton::toggled,
             this, &MainWindow::onMountainTypeChanged,
             Qt::ConnectionType::QueuedConnection);
+    connect(depthPrepassBox, &QCheckBox::toggled,
+            this, &MainWindow::onDepthPrepassChanged,
+            Qt::ConnectionType::QueuedConnection);
 }
 void MainWindow::onMountainTypeChanged() {
     if (!glRenderer) return;
@@ -254,6 +305,68 @@ void MainWindow::onMountainTypeChanged() {
     glRenderer->settingsChanged();
 }
 
+void MainWindow::createProfilerControls() {
+    profilerBox = new QCheckBox("Show Profiler", this);
+    profilerBox->setChecked(false);
+    vLayout->addWidget(profilerBox);
+
+    connect(profilerBox, &QCheckBox::toggled,
+            this, &MainWindow::onProfilerChanged,
+            Qt::ConnectionType::QueuedConnection);
+}
+
+void MainWindow::onProfilerChanged() {
+    if (!glRenderer) return;
+
+    settings.showProfiler = profilerBox->isChecked();
+    glRenderer->settingsChanged();
+}
+
+void MainWindow::createResolutionControls() {
+    QLabel *resolution_label = new QLabel();
+    resolution_label->setText("Dynamic Resolution (GPU target):");
+    QGroupBox *resolutionGroup = new QGroupBox();
+    QHBoxLayout *resolutionLayout = new QHBoxLayout();
+
+    dynamicResolutionBox = new QCheckBox("Enabled", this);
+    dynamicResolutionBox->setChecked(false);
+    targetFrameBox = new QDoubleSpinBox(this);
+    targetFrameBox->setMinimum(4.0);
+    targetFrameBox->setMaximum(50.0);
+    targetFrameBox->setDecimals(1);
+    targetFrameBox->setSingleStep(0.1);
+    targetFrameBox->setValue(16.6);
+    targetFrameBox->setSuffix(" ms");
+
+    resolutionLayout->addWidget(dynamicResolutionBox);
+    resolutionLayout->addWidget(targetFrameBox);
+    resolutionGroup->setLayout(resolutionLayout);
+    vLayout->addWidget(resolution_label);
+    vLayout->addWidget(resolutionGroup);
+
+    connect(dynamicResolutionBox, &QCheckBox::toggled,
+            this, &MainWindow::onDynamicResolutionChanged,
+            Qt::ConnectionType::QueuedConnection);
+    connect(targetFrameBox, &QDoubleSpinBox::valueChanged,
+            this, &MainWindow::onDynamicResolutionChanged,
+            Qt::ConnectionType::QueuedConnection);
+}
+
+void MainWindow::onDynamicResolutionChanged() {
+    if (!glRenderer) return;
+
+    settings.dynamicResolution = dynamicResolutionBox->isChecked();
+    settings.targetFrameMs = targetFrameBox->value();
+    glRenderer->settingsChanged();
+}
+
+void MainWindow::onDepthPrepassChanged() {
+    if (!glRenderer) return;
+
+    settings.depthPrepass = depthPrepassBox->isChecked();
+    glRenderer->settingsChanged();
+}
+
 
 
 MainWindow::~MainWindow() {
@@ -12,6 +12,8 @@
 #include <QGroupBox>
 #include <QMainWindow>
 #include <QRadioButton>
+#include <QCheckBox>
+#include <QDoubleSpinBox>
 #include <QVBoxLayout>
 #include "glrenderer.h"
 
@@ -33,10 +35,17 @@ private:
     QRadioButton *rainButton;
     QVBoxLayout *vLayout;
     QRadioButton *noWeatherButton;
+    QCheckBox *gpuParticlesBox;
+    QSlider *intensitySlider;
+    QSpinBox *intensityBox;
 
     QRadioButton *snowMountainButton;
     QRadioButton *rockMountainButton;
     QRadioButton *grassMountainButton;
+    QCheckBox *depthPrepassBox;
+    QCheckBox *profilerBox;
+    QCheckBox *dynamicResolutionBox;
+    QDoubleSpinBox *targetFrameBox;
 
     // Helper methods
     void createWeatherControls();
@@ -46,6 +55,8 @@ private:
     void onValChangeFov(int newValue);
     void onValChangeTime(int newValue);
     void onWeatherTypeChanged();
+    void onGpuParticlesChanged();
+    void onValChangeIntensity(int newValue);
     void createSliderSpinbox(QSlider *&slider, QSpinBox *&spinbox, int min, int max, int defaultVal);
     void setupWeatherControls();
     void initSettings();
@@ -54,5 +65,14 @@ private:
     void createMountainControls();
     void setupMountainControls();
     void onMountainTypeChanged();
+    void onDepthPrepassChanged();
+
+    // profiler
+    void createProfilerControls();
+    void onProfilerChanged();
+
+    // dynamic resolution
+    void createResolutionControls();
+    void onDynamicResolutionChanged();
     // Event handlers
 };
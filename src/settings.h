@@ -20,7 +20,18 @@ struct Settings {
     float fov;
     float time;
     WeatherType weather;
+    float weatherIntensity;  // 0-1, fraction of the particle budget in use
+    bool gpuParticles;   // Simulate particles with transform feedback instead of on the CPU
     MountainType mountain;
+    bool depthPrepass;   // Lay down terrain depth first so terrain.frag shades each pixel once
+    bool showProfiler = false;  // Time every pass and draw the results over the scene
+    bool dynamicResolution = false;  // Lower the render scale (down to 50%) to hold targetFrameMs
+    float targetFrameMs = 16.6f;     // GPU time per frame that dynamic resolution aims for
+    int maxTextureSize = 2048;  // Longest side of loaded textures, larger sources are downscaled
+    std::string statsLogPath;   // CSV log of RendererStats, "-" for stdout, empty to disable
+    int statsLogInterval = 1000;  // Milliseconds between logged rows
+    std::string recordPath;     // Camera recording written on exit, empty to disable
+    std::string replayPath;     // Camera recording flown at a fixed timestep, empty to disable
 };
 
 
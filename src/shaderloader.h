@@ -2,48 +2,127 @@
 
 #include "GL/glew.h"
 #include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QByteArrayView>
 #include <iostream>
 #include <QTextStream>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 class ShaderLoader{
 public:
-    static GLuint createShaderProgram(const char * vertex_file_path, const char * fragment_file_path){
+    // defines are injected into both stages as "#define NAME" (or "NAME VALUE") lines
+    static GLuint createShaderProgram(const char * vertex_file_path, const char * fragment_file_path,
+                                      const std::vector<std::string> &defines = {}){
+        std::string vertexCode = injectDefines(readShader(vertex_file_path), defines);
+        std::string fragmentCode = injectDefines(readShader(fragment_file_path), defines);
+
+        // A cached binary skips compiling and linking entirely
+        QString binaryPath = binaryCachePath({vertexCode, fragmentCode});
+        GLuint programID = loadProgramBinary(binaryPath);
+        if (programID) return programID;
+
         // Create and compile the shaders.
-        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
-        GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
+        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertexCode, vertex_file_path);
+        GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragmentCode, fragment_file_path);
         // Link the shader program.
-        GLuint programID = glCreateProgram();
+        programID = glCreateProgram();
         glAttachShader(programID, vertexShaderID);
         glAttachShader(programID, fragmentShaderID);
-        glLinkProgram(programID);
-        // Print the info log if error
-        GLint status;
-        glGetProgramiv(programID, GL_LINK_STATUS, &status);
-        if (status == GL_FALSE) {
-            GLint length;
-            glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
-            std::string log(length, '\0');
-            glGetProgramInfoLog(programID, length, nullptr, &log[0]);
+        linkProgram(programID, {vertexShaderID, fragmentShaderID});
+        saveProgramBinary(programID, binaryPath);
+        return programID;
+    }
+
+    // Returns the program specialised by defines, compiling it on first use. Variants are
+    // owned by the cache and stay alive until releaseVariants().
+    static GLuint getVariant(const char * vertex_file_path, const char * fragment_file_path,
+                             std::vector<std::string> defines){
+        std::sort(defines.begin(), defines.end());
+        std::string key = std::string(vertex_file_path) + '|' + fragment_file_path;
+        for (const std::string &define : defines) {
+            key += '|' + define;
+        }
+        auto &cache = variantCache();
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            return it->second;
+        }
+        GLuint programID = createShaderProgram(vertex_file_path, fragment_file_path, defines);
+        cache.emplace(key, programID);
+        return programID;
+    }
+
+    // Deletes every cached variant; needs the owning context to be current. onRelease sees
+    // each program just before it is deleted.
+    static void releaseVariants(const std::function<void(GLuint)> &onRelease = nullptr){
+        for (auto &[key, programID] : variantCache()) {
+            if (onRelease) onRelease(programID);
             glDeleteProgram(programID);
-            throw std::runtime_error(log);
         }
-        // Shaders no longer necessary, stored in program
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragmentShaderID);
+        variantCache().clear();
+    }
+
+    // Builds a vertex-only program whose outputs are captured with transform feedback.
+    // The varyings are interleaved into a single buffer in the order given.
+    static GLuint createTransformFeedbackProgram(const char * vertex_file_path, const std::vector<const char *> &varyings){
+        std::string vertexCode = readShader(vertex_file_path);
+
+        // The varying layout is part of the linked binary, so it is part of the key too
+        std::string layout;
+        for (const char *varying : varyings) {
+            layout += std::string(varying) + ';';
+        }
+        QString binaryPath = binaryCachePath({vertexCode, layout});
+        GLuint programID = loadProgramBinary(binaryPath);
+        if (programID) return programID;
+
+        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertexCode, vertex_file_path);
+        programID = glCreateProgram();
+        glAttachShader(programID, vertexShaderID);
+        // Varyings must be declared before linking
+        glTransformFeedbackVaryings(programID, static_cast<GLsizei>(varyings.size()), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        linkProgram(programID, {vertexShaderID});
+        saveProgramBinary(programID, binaryPath);
         return programID;
     }
 private:
-    static GLuint createShader(GLenum shaderType, const char *filepath){
-        GLuint shaderID = glCreateShader(shaderType);
-        // Read shader file.
-        std::string code;
-        QString filepathStr = QString(filepath);
-        QFile file(filepathStr);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            QTextStream stream(&file);
-            code = stream.readAll().toStdString();
-        }else{
+    static std::map<std::string, GLuint> &variantCache(){
+        static std::map<std::string, GLuint> cache;
+        return cache;
+    }
+
+    // The defines go right after #version, which has to stay the first statement
+    static std::string injectDefines(const std::string &code, const std::vector<std::string> &defines){
+        if (defines.empty()) return code;
+        std::string block;
+        for (const std::string &define : defines) {
+            block += "#define " + define + "\n";
+        }
+        size_t version = code.find("#version");
+        if (version == std::string::npos) return block + code;
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos) return code + "\n" + block;
+        return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+    }
+
+    static std::string readShader(const char *filepath){
+        QFile file{QString(filepath)};
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
             throw std::runtime_error(std::string("Failed to open shader: ")+filepath);
         }
+        QTextStream stream(&file);
+        return stream.readAll().toStdString();
+    }
+
+    static GLuint createShader(GLenum shaderType, const std::string &code, const char *filepath){
+        GLuint shaderID = glCreateShader(shaderType);
         // Compile shader code.
         const char *codePtr = code.c_str();
         glShaderSource(shaderID, 1, &codePtr, nullptr); // Assumes code is null terminated
@@ -57,8 +136,97 @@ private:
             std::string log(length, '\0');
             glGetShaderInfoLog(shaderID, length, nullptr, &log[0]);
             glDeleteShader(shaderID);
-            throw std::runtime_error(log);
+            throw std::runtime_error(std::string(filepath) + ": " + log);
         }
         return shaderID;
     }
+
+    // Links and releases the shaders; throws with the info log if linking fails
+    static void linkProgram(GLuint programID, const std::vector<GLuint> &shaders){
+        if (GLEW_ARB_get_program_binary) {
+            glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(programID);
+        // Shaders no longer necessary, stored in program
+        for (GLuint shaderID : shaders) {
+            glDeleteShader(shaderID);
+        }
+        GLint status;
+        glGetProgramiv(programID, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE) {
+            GLint length;
+            glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &length);
+            std::string log(length, '\0');
+            glGetProgramInfoLog(programID, length, nullptr, &log[0]);
+            glDeleteProgram(programID);
+            throw std::runtime_error(log);
+        }
+    }
+
+    // Cache entry for the given sources on this driver, or an empty string if binaries are
+    // unsupported. Any change to the sources, GPU or driver version selects a new entry.
+    static QString binaryCachePath(const std::vector<std::string> &sources){
+        if (!GLEW_ARB_get_program_binary) return QString();
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats == 0) return QString();
+
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders";
+        if (!QDir().mkpath(dir)) return QString();
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const char *value = reinterpret_cast<const char *>(glGetString(name));
+            hash.addData(QByteArrayView(value ? value : "", value ? static_cast<qsizetype>(strlen(value)) : 0));
+            hash.addData(QByteArrayView("\n", 1));
+        }
+        for (const std::string &source : sources) {
+            hash.addData(QByteArrayView(source.data(), static_cast<qsizetype>(source.size())));
+            hash.addData(QByteArrayView("\0", 1));
+        }
+        return dir + "/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+    }
+
+    // Returns 0 on a miss or if the driver rejects the stored binary
+    static GLuint loadProgramBinary(const QString &path){
+        if (path.isEmpty()) return 0;
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return 0;
+        QByteArray contents = file.readAll();
+        if (contents.size() <= static_cast<qint64>(sizeof(GLenum))) return 0;
+
+        GLenum format;
+        memcpy(&format, contents.constData(), sizeof(format));
+        GLuint programID = glCreateProgram();
+        glProgramBinary(programID, format, contents.constData() + sizeof(format),
+                        static_cast<GLsizei>(contents.size() - sizeof(format)));
+        GLint status;
+        glGetProgramiv(programID, GL_LINK_STATUS, &status);
+        if (status == GL_FALSE) {
+            // Typically a driver update; recompile and overwrite the entry
+            glDeleteProgram(programID);
+            return 0;
+        }
+        return programID;
+    }
+
+    // Layout: binary format enum followed by the driver's program binary
+    static void saveProgramBinary(GLuint programID, const QString &path){
+        if (path.isEmpty()) return;
+        GLint length = 0;
+        glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) return;
+
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(programID, length, nullptr, &format, binary.data());
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) return;
+        file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+        file.write(binary.data(), length);
+        if (!file.commit()) {
+            std::cerr << "Failed to write shader cache " << path.toStdString() << std::endl;
+        }
+    }
 };
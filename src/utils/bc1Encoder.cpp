@@ -0,0 +1,142 @@
+#include "bc1Encoder.h"
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+uint16_t packRGB565(const float* c) {
+    int r = std::clamp(static_cast<int>(std::lround(c[0] * 31.0f / 255.0f)), 0, 31);
+    int g = std::clamp(static_cast<int>(std::lround(c[1] * 63.0f / 255.0f)), 0, 63);
+    int b = std::clamp(static_cast<int>(std::lround(c[2] * 31.0f / 255.0f)), 0, 31);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpackRGB565(uint16_t v, int* c) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+// 16 RGB texels in, 8 bytes out
+void encodeBlock(const uint8_t texels[16][3], uint8_t* out) {
+    // Mean and covariance of the block
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) mean[c] += texels[i][c];
+    }
+    for (int c = 0; c < 3; c++) mean[c] /= 16.0f;
+
+    float cov[6] = {0, 0, 0, 0, 0, 0};  // rr, rg, rb, gg, gb, bb
+    for (int i = 0; i < 16; i++) {
+        float r = texels[i][0] - mean[0], g = texels[i][1] - mean[1], b = texels[i][2] - mean[2];
+        cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+        cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+    }
+
+    // Principal axis by a few power iterations, starting from the luminance direction
+    float axis[3] = {0.299f, 0.587f, 0.114f};
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+        if (length < 1e-6f) break;  // Flat block, any axis will do
+        axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+    }
+
+    // Endpoints are the extreme projections onto the axis
+    float minDot = 1e30f, maxDot = -1e30f;
+    int minIndex = 0, maxIndex = 0;
+    for (int i = 0; i < 16; i++) {
+        float d = texels[i][0] * axis[0] + texels[i][1] * axis[1] + texels[i][2] * axis[2];
+        if (d < minDot) { minDot = d; minIndex = i; }
+        if (d > maxDot) { maxDot = d; maxIndex = i; }
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++) {
+        high[c] = texels[maxIndex][c];
+        low[c] = texels[minIndex][c];
+    }
+    uint16_t color0 = packRGB565(high);
+    uint16_t color1 = packRGB565(low);
+
+    uint32_t indices = 0;
+    if (color0 == color1) {
+        // Single colour; index 0 everywhere
+    }
+    else {
+        // color0 > color1 selects four-colour mode
+        if (color0 < color1) std::swap(color0, color1);
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = texels[i][0] - palette[p][0];
+                int dg = texels[i][1] - palette[p][1];
+                int db = texels[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) { bestError = error; best = p; }
+            }
+            indices |= static_cast<uint32_t>(best) << (i * 2);
+        }
+    }
+
+    // Little-endian: color0, color1, then 16 2-bit indices, texel 0 in the low bits
+    out[0] = color0 & 0xff; out[1] = color0 >> 8;
+    out[2] = color1 & 0xff; out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++) out[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+}
+
+namespace BC1 {
+
+std::vector<uint8_t> encode(const uint8_t* rgba, int width, int height, unsigned threadCount) {
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    std::vector<uint8_t> out(encodedSize(width, height));
+
+    auto encodeRows = [&](int firstRow, int lastRow) {
+        uint8_t texels[16][3];
+        for (int by = firstRow; by < lastRow; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                // Partial blocks at the right/bottom edge repeat the last texel
+                for (int i = 0; i < 16; i++) {
+                    int x = std::min(bx * 4 + (i & 3), width - 1);
+                    int y = std::min(by * 4 + (i >> 2), height - 1);
+                    std::memcpy(texels[i], &rgba[(static_cast<size_t>(y) * width + x) * 4], 3);
+                }
+                encodeBlock(texels, &out[(static_cast<size_t>(by) * blocksX + bx) * 8]);
+            }
+        }
+    };
+
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min<unsigned>(threadCount, blocksY);
+    if (threadCount <= 1) {
+        encodeRows(0, blocksY);
+        return out;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; t++) {
+        int first = blocksY * t / threadCount;
+        int last = blocksY * (t + 1) / threadCount;
+        threads.emplace_back(encodeRows, first, last);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return out;
+}
+
+}
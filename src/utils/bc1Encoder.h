@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Software BC1 (DXT1) encoder for opaque textures: every 4x4 block becomes two RGB565
+// endpoints along the block's principal colour axis plus 2-bit indices, 8 bytes per block.
+namespace BC1 {
+
+// Bytes needed for an image of the given size (partial blocks round up)
+inline size_t encodedSize(int width, int height) {
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+// Encodes tightly packed RGBA8 pixels (alpha ignored). Rows of blocks are split across
+// threadCount threads; 0 uses every hardware thread.
+std::vector<uint8_t> encode(const uint8_t* rgba, int width, int height, unsigned threadCount = 0);
+
+}
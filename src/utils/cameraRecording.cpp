@@ -0,0 +1,95 @@
+#include "cameraRecording.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char MAGIC[4] = {'N', 'W', 'C', 'R'};
+
+template <typename T>
+void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+} // namespace
+
+void CameraRecording::cameraAt(float time, glm::vec3& eye, glm::vec3& look) const {
+    if (m_samples.empty()) return;
+    auto next = std::upper_bound(m_samples.begin(), m_samples.end(), time,
+                                 [](float t, const Sample& sample) { return t < sample.time; });
+    if (next == m_samples.begin() || next == m_samples.end()) {
+        const Sample& held = next == m_samples.end() ? m_samples.back() : m_samples.front();
+        eye = held.eye;
+        look = held.look;
+        return;
+    }
+    const Sample& previous = *(next - 1);
+    float span = next->time - previous.time;
+    float t = span > 0.0f ? (time - previous.time) / span : 1.0f;
+    eye = glm::mix(previous.eye, next->eye, t);
+    look = glm::mix(previous.look, next->look, t);
+}
+
+bool CameraRecording::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    out.write(MAGIC, sizeof(MAGIC));
+    writeValue(out, VERSION);
+    writeValue(out, m_seed);
+    writeValue(out, static_cast<uint32_t>(m_samples.size()));
+    for (const Sample& sample : m_samples) {
+        writeValue(out, sample.time);
+        writeValue(out, sample.keys);
+        for (int i = 0; i < 3; i++) writeValue(out, sample.eye[i]);
+        for (int i = 0; i < 3; i++) writeValue(out, sample.look[i]);
+    }
+    if (!out) {
+        std::cerr << "Failed to write camera recording " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool CameraRecording::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !readValue(in, version) || version != VERSION || !readValue(in, m_seed) || !readValue(in, count)) {
+        std::cerr << "Not a camera recording: " << path << std::endl;
+        return false;
+    }
+
+    // Check the count against the file before trusting it with an allocation
+    const std::streamoff sampleSize = sizeof(float) + sizeof(uint32_t) + 6 * sizeof(float);
+    std::streamoff start = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streamoff remaining = in.tellg() - start;
+    in.seekg(start);
+    if (remaining < static_cast<std::streamoff>(count) * sampleSize) {
+        std::cerr << "Truncated camera recording: " << path << std::endl;
+        return false;
+    }
+
+    m_samples.clear();
+    m_samples.reserve(count);
+    for (uint32_t n = 0; n < count; n++) {
+        Sample sample;
+        bool ok = readValue(in, sample.time) && readValue(in, sample.keys);
+        for (int i = 0; i < 3; i++) ok = ok && readValue(in, sample.eye[i]);
+        for (int i = 0; i < 3; i++) ok = ok && readValue(in, sample.look[i]);
+        if (!ok) {
+            std::cerr << "Truncated camera recording: " << path << std::endl;
+            return false;
+        }
+        m_samples.push_back(sample);
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+
+// Timestamped camera states and movement keys captured from an interactive session.
+// Replays sample the camera at a fixed timestep, so the path does not depend on how
+// evenly the original frames were spaced.
+//
+// File layout (native endianness): "NWCR", uint32 version, uint64 particle seed,
+// uint32 sample count, then per sample: float time in seconds, uint32 key mask,
+// float eye[3], float look[3].
+class CameraRecording {
+public:
+    enum Key : uint32_t {
+        KEY_FORWARD = 1 << 0,
+        KEY_LEFT = 1 << 1,
+        KEY_BACK = 1 << 2,
+        KEY_RIGHT = 1 << 3,
+        KEY_UP = 1 << 4,
+        KEY_DOWN = 1 << 5
+    };
+
+    struct Sample {
+        float time;
+        uint32_t keys;
+        glm::vec3 eye;
+        glm::vec3 look;
+    };
+
+    uint64_t getSeed() const { return m_seed; }
+    void setSeed(uint64_t seed) { m_seed = seed; }
+
+    void add(const Sample& sample) { m_samples.push_back(sample); }
+    const std::vector<Sample>& getSamples() const { return m_samples; }
+    bool isEmpty() const { return m_samples.empty(); }
+    float getDuration() const { return m_samples.empty() ? 0.0f : m_samples.back().time; }
+
+    // Camera at time seconds, linear between samples and held past either end
+    void cameraAt(float time, glm::vec3& eye, glm::vec3& look) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+private:
+    static constexpr uint32_t VERSION = 1;
+    uint64_t m_seed = 0;
+    std::vector<Sample> m_samples;
+};
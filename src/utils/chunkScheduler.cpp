@@ -0,0 +1,103 @@
+#include "chunkScheduler.h"
+#include "trace.h"
+#include <chrono>
+#include <algorithm>
+
+ChunkScheduler::ChunkScheduler(TerrainGenerator* terrainGenerator, ReadyCallback onReady)
+    : m_running(true)
+    , m_terrainGenerator(terrainGenerator)
+    , m_onReady(std::move(onReady))
+{
+    // Start worker thread
+    m_workerThread = std::make_unique<std::thread>([this]() { processQueue(); });
+}
+
+ChunkScheduler::~ChunkScheduler() {
+    shutdown();
+}
+
+bool ChunkScheduler::addChunk(int chunkX, int chunkZ) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Check queue size limit
+    bool accepted = m_pendingChunks.size() < MAX_QUEUE_SIZE;
+    if (accepted) {
+        m_pendingChunks.push_back({chunkX, chunkZ});
+    } else {
+        m_dropped++;
+    }
+    TRACE_COUNTER("Pending chunks", m_pendingChunks.size());
+    return accepted;
+}
+
+void ChunkScheduler::cancelOutside(int minX, int maxX, int minZ, int maxZ) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto outside = [&](const std::pair<int, int>& chunk) {
+        return chunk.first < minX || chunk.first > maxX || chunk.second < minZ || chunk.second > maxZ;
+    };
+    m_pendingChunks.erase(std::remove_if(m_pendingChunks.begin(), m_pendingChunks.end(), outside),
+                          m_pendingChunks.end());
+    TRACE_COUNTER("Pending chunks", m_pendingChunks.size());
+}
+
+void ChunkScheduler::shutdown() {
+    m_running = false;
+
+    if (m_workerThread && m_workerThread->joinable()) {
+        m_workerThread->join();
+    }
+}
+
+bool ChunkScheduler::isProcessing() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_pendingChunks.empty();
+}
+
+size_t ChunkScheduler::getQueueSize() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pendingChunks.size();
+}
+
+ChunkScheduler::Stats ChunkScheduler::getStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return Stats{m_pendingChunks.size(), m_inFlight.load(), m_dropped.load()};
+}
+
+void ChunkScheduler::processQueue() {
+    Trace::setThreadName("Terrain worker");
+    while (m_running) {
+        std::pair<int, int> chunkCoords;
+        bool hasWork = false;
+
+        // Get next chunk to process
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_pendingChunks.empty()) {
+                chunkCoords = m_pendingChunks.front();
+                m_pendingChunks.pop_front();
+                hasWork = true;
+                m_inFlight++;
+                TRACE_COUNTER("Pending chunks", m_pendingChunks.size());
+            }
+        }
+
+        if (hasWork) {
+            // Generate terrain data
+            ChunkData chunk;
+            chunk.chunkX = chunkCoords.first;
+            chunk.chunkZ = chunkCoords.second;
+            {
+                TRACE_SCOPE("Chunk generate");
+                chunk.terrainData = m_terrainGenerator->generateTerrainChunk(chunk.chunkX, chunk.chunkZ);
+            }
+            chunk.vertexCount = chunk.terrainData.size() / 11; // Assuming 11 floats per vertex
+
+            TRACE_SCOPE("Chunk emit");
+            m_onReady(chunk);
+            m_inFlight--;
+        } else {
+            // Sleep to prevent busy waiting
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+    }
+}
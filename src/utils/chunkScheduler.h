@@ -0,0 +1,73 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+#include "terrain.h"
+
+// Generates requested terrain chunks on a worker thread, in request order. Plain C++ so it
+// can run without Qt; TerrainGenerationQueue wraps it to deliver chunks as a signal.
+class ChunkScheduler {
+public:
+    struct ChunkData {
+        int chunkX;
+        int chunkZ;
+        std::vector<float> terrainData;
+        int vertexCount;
+    };
+
+    struct Stats {
+        size_t pending;     // Waiting in the queue
+        size_t inFlight;    // Being generated by the worker
+        uint64_t dropped;   // Refused because the queue was full, since construction
+    };
+
+    // onReady is called on the worker thread for every generated chunk
+    using ReadyCallback = std::function<void(ChunkData& chunk)>;
+
+    ChunkScheduler(TerrainGenerator* terrainGenerator, ReadyCallback onReady);
+    ~ChunkScheduler();
+
+    // False if the queue is full and the request was dropped
+    bool addChunk(int chunkX, int chunkZ);
+    // Drops pending requests outside [minX, maxX] x [minZ, maxZ]; chunks already being
+    // generated still arrive
+    void cancelOutside(int minX, int maxX, int minZ, int maxZ);
+    void shutdown();
+    bool isProcessing();
+    size_t getQueueSize();
+    Stats getStats();
+
+private:
+    // Worker thread function
+    void processQueue();
+
+    // Queue for pending chunk generation requests
+    std::deque<std::pair<int, int>> m_pendingChunks;
+
+    // Mutex for thread synchronization
+    std::mutex m_mutex;
+
+    // Worker thread
+    std::unique_ptr<std::thread> m_workerThread;
+
+    // Flag to control worker thread
+    std::atomic<bool> m_running;
+
+    std::atomic<size_t> m_inFlight{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    // Reference to the terrain generator
+    TerrainGenerator* m_terrainGenerator;
+    ReadyCallback m_onReady;
+
+    // Maximum number of pending chunks in queue. Out-of-range requests are cancelled, so
+    // this only guards against callers that never cancel; a full render area fits.
+    static const size_t MAX_QUEUE_SIZE = 4096;
+};
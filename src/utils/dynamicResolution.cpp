@@ -0,0 +1,79 @@
+#include "dynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+void DynamicResolution::initialize() {
+    if (m_hasQueries) return;
+    glGenQueries(FRAMES_IN_FLIGHT * 2, &m_queries[0][0]);
+    m_hasQueries = true;
+}
+
+void DynamicResolution::release() {
+    if (!m_hasQueries) return;
+    glDeleteQueries(FRAMES_IN_FLIGHT * 2, &m_queries[0][0]);
+    *this = DynamicResolution();
+}
+
+void DynamicResolution::beginFrame() {
+    if (!m_hasQueries) return;
+    collect(m_frame);
+    // Skip measuring rather than wait when the GPU is this far behind
+    m_recording = !m_pending[m_frame];
+    if (m_recording) glQueryCounter(m_queries[m_frame][0], GL_TIMESTAMP);
+}
+
+void DynamicResolution::endFrame() {
+    if (!m_recording) return;
+    glQueryCounter(m_queries[m_frame][1], GL_TIMESTAMP);
+    m_pending[m_frame] = true;
+    m_recording = false;
+    m_frame = (m_frame + 1) % FRAMES_IN_FLIGHT;
+}
+
+void DynamicResolution::collect(int frame) {
+    if (!m_pending[frame]) return;
+    GLint available = 0;
+    glGetQueryObjectiv(m_queries[frame][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(m_queries[frame][0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(m_queries[frame][1], GL_QUERY_RESULT, &end);
+    m_pending[frame] = false;
+
+    float ms = (end - start) * 1e-6f;
+    m_gpuMs = m_gpuMs > 0.0f ? m_gpuMs + SMOOTHING * (ms - m_gpuMs) : ms;
+}
+
+void DynamicResolution::update(float targetMs) {
+    for (int frame = 0; frame < FRAMES_IN_FLIGHT; frame++) {
+        collect(frame);
+    }
+    if (m_gpuMs <= 0.0f || targetMs <= 0.0f) return;
+    if (m_settle > 0) {
+        // Let the smoothed time catch up with the last change first
+        m_settle--;
+        return;
+    }
+
+    // Fill-bound passes scale with the pixel count, the square of the scale
+    float ratio = std::sqrt(targetMs / m_gpuMs);
+    float scale = m_scale;
+    if (m_gpuMs > targetMs) {
+        scale = m_scale * ratio;
+    } else if (m_gpuMs < targetMs * HEADROOM) {
+        scale = m_scale * std::min(ratio, MAX_GROWTH);
+    }
+    // Steps of 1/64 keep the target from changing size over noise alone
+    scale = std::clamp(std::round(scale * 64.0f) / 64.0f, MIN_SCALE, MAX_SCALE);
+    if (scale != m_scale) {
+        m_scale = scale;
+        m_settle = SETTLE_FRAMES;
+    }
+}
+
+void DynamicResolution::reset() {
+    m_scale = MAX_SCALE;
+    m_gpuMs = 0.0f;
+    m_settle = 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "GL/glew.h"
+
+// Chooses the fraction of the output resolution to render the scene at, so that GPU time
+// stays near a target. Each frame is bracketed with GL_TIMESTAMP queries, which do not
+// interfere with the profiler's GL_TIME_ELAPSED ones; results are read a few frames later,
+// once available, so measuring never stalls the pipeline.
+class DynamicResolution {
+public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MAX_SCALE = 1.0f;
+
+    // Query objects live in the current context; both need it to be current
+    void initialize();
+    void release();
+
+    // Bracket the scaled passes of a frame
+    void beginFrame();
+    void endFrame();
+
+    // Folds in finished measurements and adjusts the scale towards targetMs
+    void update(float targetMs);
+    // Back to full resolution with no history, e.g. when the feature is switched off
+    void reset();
+
+    float getScale() const { return m_scale; }
+    float getGpuMs() const { return m_gpuMs; }  // Smoothed
+
+private:
+    static const int FRAMES_IN_FLIGHT = 4;
+    static const int SETTLE_FRAMES = 15;              // Frames between scale changes
+    static constexpr float SMOOTHING = 0.1f;          // Weight of each new sample
+    static constexpr float HEADROOM = 0.85f;          // Scale up only below this fraction of the target
+    static constexpr float MAX_GROWTH = 1.05f;        // Largest scale increase per change
+
+    void collect(int frame);
+
+    GLuint m_queries[FRAMES_IN_FLIGHT][2] = {};  // Start, end timestamps
+    bool m_pending[FRAMES_IN_FLIGHT] = {};
+    bool m_hasQueries = false;
+    int m_frame = 0;       // Slot of the frame being recorded
+    bool m_recording = false;
+    float m_gpuMs = 0.0f;  // 0 until the first sample
+    float m_scale = MAX_SCALE;
+    int m_settle = 0;
+};
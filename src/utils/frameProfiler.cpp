@@ -0,0 +1,121 @@
+#include "frameProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+const char* FrameProfiler::sectionName(Section section) {
+    switch (section) {
+    case TERRAIN: return "Terrain";
+    case DOME: return "Sky";
+    case WATER: return "Water";
+    case PARTICLES: return "Particles";
+    case PARTICLE_UPDATE: return "Particle update";
+    case CHUNK_UPLOAD: return "Chunk upload";
+    default: return "";
+    }
+}
+
+FrameProfiler::Scope::Scope(FrameProfiler& profiler, Section section)
+    : m_profiler(profiler.m_enabled ? &profiler : nullptr)
+    , m_section(section) {
+    if (!m_profiler) return;
+    m_query = m_profiler->beginQuery(section);
+    m_start = std::chrono::steady_clock::now();
+}
+
+FrameProfiler::Scope::~Scope() {
+    if (!m_profiler) return;
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+    m_profiler->m_sections[m_section].cpu.add(elapsed.count());
+    if (m_query >= 0) m_profiler->endQuery(m_section, m_query);
+}
+
+void FrameProfiler::initialize() {
+    if (m_hasQueries) return;
+    for (SectionData& data : m_sections) {
+        glGenQueries(2, data.queries);
+    }
+    m_hasQueries = true;
+}
+
+void FrameProfiler::release() {
+    if (!m_hasQueries) return;
+    for (SectionData& data : m_sections) {
+        glDeleteQueries(2, data.queries);
+        data = SectionData();
+    }
+    m_hasQueries = false;
+}
+
+void FrameProfiler::setEnabled(bool enabled) {
+    if (enabled && !m_enabled) {
+        // Results still in flight are dropped with the old window; their queries are
+        // simply reused
+        for (SectionData& data : m_sections) {
+            data.cpu = Samples();
+            data.gpu = Samples();
+            data.pending[0] = data.pending[1] = false;
+        }
+    }
+    m_enabled = enabled;
+}
+
+// Returns the query slot to time with, or -1 if both are still waiting on the GPU
+int FrameProfiler::beginQuery(Section section) {
+    if (!m_hasQueries || m_queryActive) return -1;
+    SectionData& data = m_sections[section];
+    collect(data, 0);
+    collect(data, 1);
+
+    int query = data.nextQuery;
+    if (data.pending[query]) {
+        query ^= 1;
+        if (data.pending[query]) return -1;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, data.queries[query]);
+    m_queryActive = true;
+    return query;
+}
+
+void FrameProfiler::endQuery(Section section, int query) {
+    SectionData& data = m_sections[section];
+    glEndQuery(GL_TIME_ELAPSED);
+    m_queryActive = false;
+    data.pending[query] = true;
+    data.nextQuery = query ^ 1;
+}
+
+// Reads a finished query without waiting; a result that is not ready stays pending
+void FrameProfiler::collect(SectionData& data, int query) {
+    if (!data.pending[query]) return;
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(data.queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) return;
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(data.queries[query], GL_QUERY_RESULT, &nanoseconds);
+    data.pending[query] = false;
+    if (m_enabled) data.gpu.add(nanoseconds * 1e-6f);
+}
+
+void FrameProfiler::Samples::add(float ms) {
+    values[next] = ms;
+    next = (next + 1) % WINDOW;
+    count = std::min<size_t>(count + 1, WINDOW);
+}
+
+FrameProfiler::Stats FrameProfiler::Samples::stats() const {
+    Stats result;
+    result.samples = count;
+    if (count == 0) return result;
+
+    std::vector<float> sorted(values.begin(), values.begin() + count);
+    std::sort(sorted.begin(), sorted.end());
+    float sum = 0.0f;
+    for (float value : sorted) sum += value;
+    result.min = sorted.front();
+    result.avg = sum / count;
+    // Nearest-rank percentile; with a short window this is close to the max
+    size_t rank = static_cast<size_t>(std::ceil(0.99 * count));
+    result.p99 = sorted[std::min(count, std::max<size_t>(rank, 1)) - 1];
+    return result;
+}
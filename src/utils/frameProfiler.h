@@ -0,0 +1,86 @@
+#pragma once
+
+#include "GL/glew.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+// CPU and GPU time per render pass over a rolling window of recent samples. GPU times
+// come from GL_TIME_ELAPSED queries, two per section in flight, so a result is only
+// read once it is available and the profiler never stalls the pipeline.
+class FrameProfiler {
+public:
+    enum Section {
+        TERRAIN,
+        DOME,
+        WATER,
+        PARTICLES,
+        PARTICLE_UPDATE,
+        CHUNK_UPLOAD,
+        SECTION_COUNT
+    };
+    static const char* sectionName(Section section);
+
+    // Milliseconds over the samples currently in the window
+    struct Stats {
+        float min = 0.0f;
+        float avg = 0.0f;
+        float p99 = 0.0f;
+        size_t samples = 0;
+    };
+
+    // Times a section on both the CPU and the GPU for as long as it lives. Sections may
+    // be nested on the CPU; only the outermost one gets a GPU query.
+    class Scope {
+    public:
+        Scope(FrameProfiler& profiler, Section section);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameProfiler* m_profiler;  // Null while profiling is off
+        Section m_section;
+        int m_query = -1;           // Query slot in use, -1 if the GPU is not timed
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Query objects live in the current context; both need it to be current
+    void initialize();
+    void release();
+
+    // Disabled profilers cost one branch per scope. Enabling starts from empty windows.
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    Stats cpuStats(Section section) const { return m_sections[section].cpu.stats(); }
+    Stats gpuStats(Section section) const { return m_sections[section].gpu.stats(); }
+
+private:
+    static const int WINDOW = 120;  // Samples kept per section, about two seconds at 60 fps
+
+    struct Samples {
+        std::array<float, WINDOW> values = {};
+        size_t count = 0;
+        size_t next = 0;
+        void add(float ms);
+        Stats stats() const;
+    };
+
+    struct SectionData {
+        GLuint queries[2] = {0, 0};
+        bool pending[2] = {false, false};  // Issued, result not read yet
+        int nextQuery = 0;
+        Samples cpu;
+        Samples gpu;
+    };
+
+    int beginQuery(Section section);
+    void endQuery(Section section, int query);
+    void collect(SectionData& data, int query);
+
+    std::array<SectionData, SECTION_COUNT> m_sections;
+    bool m_enabled = false;
+    bool m_hasQueries = false;
+    bool m_queryActive = false;  // GL_TIME_ELAPSED queries cannot nest
+};
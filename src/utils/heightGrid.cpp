@@ -0,0 +1,55 @@
+#include "heightGrid.h"
+#include <cmath>
+#include <algorithm>
+
+HeightGrid::HeightGrid(int resolution, float spacing)
+    : m_resolution(resolution)
+    , m_spacing(spacing)
+    , m_originCell(0, 0)
+{
+    m_heights.resize(m_resolution * m_resolution, 0.0f);
+}
+
+bool HeightGrid::recenter(TerrainGenerator& terrain, float worldX, float worldZ) {
+    glm::ivec2 origin(static_cast<int>(std::floor(worldX / m_spacing)) - m_resolution / 2,
+                      static_cast<int>(std::floor(worldZ / m_spacing)) - m_resolution / 2);
+    if (m_valid && origin == m_originCell) {
+        return false;
+    }
+
+    m_scratch.resize(m_heights.size());
+    glm::ivec2 shift = origin - m_originCell;
+    for (int z = 0; z < m_resolution; z++) {
+        for (int x = 0; x < m_resolution; x++) {
+            // Reuse the sample if the old grid already covered this cell
+            int oldX = x + shift.x;
+            int oldZ = z + shift.y;
+            if (m_valid && oldX >= 0 && oldX < m_resolution && oldZ >= 0 && oldZ < m_resolution) {
+                m_scratch[z * m_resolution + x] = m_heights[oldZ * m_resolution + oldX];
+            } else {
+                m_scratch[z * m_resolution + x] = terrain.getWorldHeight((origin.x + x) * m_spacing,
+                                                                         (origin.y + z) * m_spacing);
+            }
+        }
+    }
+
+    m_heights.swap(m_scratch);
+    m_originCell = origin;
+    m_valid = true;
+    return true;
+}
+
+float HeightGrid::sample(float worldX, float worldZ) const {
+    float gx = std::clamp(worldX / m_spacing - m_originCell.x, 0.0f, m_resolution - 1.001f);
+    float gz = std::clamp(worldZ / m_spacing - m_originCell.y, 0.0f, m_resolution - 1.001f);
+    int x0 = static_cast<int>(gx);
+    int z0 = static_cast<int>(gz);
+    float tx = gx - x0;
+    float tz = gz - z0;
+
+    const float* row0 = &m_heights[z0 * m_resolution + x0];
+    const float* row1 = row0 + m_resolution;
+    float h0 = row0[0] + (row0[1] - row0[0]) * tx;
+    float h1 = row1[0] + (row1[1] - row1[0]) * tx;
+    return h0 + (h1 - h0) * tz;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "terrain.h"
+
+// Coarse terrain height samples on a square grid that follows the camera. Particles
+// collide against it with one bilinear lookup instead of evaluating the noise.
+class HeightGrid {
+public:
+    HeightGrid(int resolution = 64, float spacing = 4.0f);
+
+    // Snaps the grid to the cell containing (worldX, worldZ). Rows and columns still
+    // covered after the move are kept; only the newly exposed ones are sampled.
+    // Returns true if any height changed.
+    bool recenter(TerrainGenerator& terrain, float worldX, float worldZ);
+
+    // Bilinear terrain height, clamped to the grid edge outside its extent
+    float sample(float worldX, float worldZ) const;
+
+    bool isValid() const { return m_valid; }
+    int getResolution() const { return m_resolution; }
+    float getSpacing() const { return m_spacing; }
+    glm::vec2 getOrigin() const { return glm::vec2(m_originCell) * m_spacing; } // World position of sample (0, 0)
+    const std::vector<float>& getHeights() const { return m_heights; }          // Row-major, x fastest
+
+private:
+    int m_resolution;
+    float m_spacing;
+    glm::ivec2 m_originCell;
+    bool m_valid = false;
+    std::vector<float> m_heights;
+    std::vector<float> m_scratch;
+};
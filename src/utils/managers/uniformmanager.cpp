@@ -1,116 +1,161 @@
 #include "utils/managers/uniformmanager.h"
 
 #include <cassert>
-#include <iostream>
-#include "utils/camera.h"
-#include "settings.h"
-#include "utils/debug.h"
+#include <cstring>
+#include <algorithm>
 
-GLuint UniformManager::getUniformLocation(const char *name)
+void UniformManager::registerProgram(GLuint program)
 {
-    assert(m_shader != 0);
-    return glGetUniformLocation(m_shader, name);
+    assert(program != 0);
+    if (m_programs.count(program)) return;
+    Program& entry = m_programs[program];
+
+    // The frame block always lives on the same binding point
+    GLuint block = glGetUniformBlockIndex(program, FRAME_BLOCK);
+    if (block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, block, FRAME_BLOCK_BINDING);
+    }
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<char> buffer(std::max(maxLength, 1));
+
+    auto add = [&](const std::string& name) {
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location < 0) return;  // Block members live in uniform buffers
+        entry.indices.emplace(name, entry.uniforms.size());
+        entry.uniforms.push_back(Uniform{location});
+    };
+
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        GLsizei length;
+        glGetActiveUniform(program, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // Arrays are reported once as "name[0]"; give each element its own entry
+        size_t bracket = name.find('[');
+        if (bracket == std::string::npos) {
+            add(name);
+            continue;
+        }
+        std::string base = name.substr(0, bracket);
+        add(base);
+        for (GLint element = 0; element < size; element++) {
+            add(base + "[" + std::to_string(element) + "]");
+        }
+    }
+}
+
+void UniformManager::releaseProgram(GLuint program)
+{
+    auto it = m_programs.find(program);
+    if (it == m_programs.end()) return;
+    if (m_current == &it->second) m_current = nullptr;
+    m_programs.erase(it);
+}
+
+void UniformManager::setFrameData(const FrameData& frame)
+{
+    static_assert(sizeof(FrameData) == 3 * 64 + 2 * 16 + 16, "FrameData must match the std140 layout");
+    if (!m_frameUbo) {
+        glGenBuffers(1, &m_frameUbo);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_frameUbo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_frameUbo);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frameUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformManager::releaseFrameBuffer()
+{
+    if (m_frameUbo) glDeleteBuffers(1, &m_frameUbo);
+    m_frameUbo = 0;
 }
 
-void UniformManager::setSceneGlobalUniform(SceneGlobalData &globalData)
+void UniformManager::use(GLuint program)
 {
-    setFloat("k_a", globalData.ka);
-    setFloat("k_d", globalData.kd);
-    setFloat("k_s", globalData.ks);
+    registerProgram(program);
+    m_current = &m_programs[program];
+    glUseProgram(program);
 }
 
-void UniformManager::setMVPUniform(const glm::mat4 &projectionMatrix, const glm::mat4& viewMatrix, const glm::mat4 &ctm)
+GLint UniformManager::getUniformLocation(std::string_view name) const
 {
-    glm::mat4 pvm = projectionMatrix * viewMatrix * ctm;
-    setMat4("pvm", pvm);
-    setMat4("model", ctm);
-    setMat4("normalMatrix", glm::transpose(glm::inverse(ctm)));
+    assert(m_current != nullptr);
+    auto it = m_current->indices.find(name);
+    return it == m_current->indices.end() ? -1 : m_current->uniforms[it->second].location;
 }
 
-void UniformManager::clearUniforms()
+UniformManager::Uniform* UniformManager::prepare(std::string_view name, const void* value, size_t size)
 {
-    // clear global
-    setFloat("k_a", 0.0f);
-    setFloat("k_d", 0.0f);
-    setFloat("k_s", 0.0f);
-
-    // clear material
-    setVec4("material.cAmbient", glm::vec4(0.0f));
-    setVec4("material.cDiffuse", glm::vec4(0.0f));
-    setVec4("material.cSpecular", glm::vec4(0.0f));
-    setFloat("material.shininess", 0.0f);
-    
-    // clear mvp
-    setMat4("model", glm::mat4(1.0f));
-    setMat4("view", glm::mat4(1.0f));
-    setMat4("projection", glm::mat4(1.0f));
-    setMat4("normalMatrix", glm::mat4(1.0f));
-
-    // clear lights
-    for (int i = 0; i < 8; i++)
-    {
-        std::string lightUniformStruct = "lights[" + std::to_string(i) + "]";
-        setBool((lightUniformStruct + ".enabled").c_str(), false);
-        setVec4((lightUniformStruct + ".color").c_str(), glm::vec4(0.0f));
-        setVec4((lightUniformStruct + ".dir").c_str(), glm::vec4(0.0f));
-        setVec4((lightUniformStruct + ".pos").c_str(), glm::vec4(0.0f));
+    assert(m_current != nullptr);
+    auto it = m_current->indices.find(name);
+    if (it == m_current->indices.end()) return nullptr;
+
+    Uniform& uniform = m_current->uniforms[it->second];
+    if (uniform.hasValue && std::memcmp(uniform.value, value, size) == 0) return nullptr;
+    std::memcpy(uniform.value, value, size);
+    uniform.hasValue = true;
+    return &uniform;
+}
+
+void UniformManager::setFloat(std::string_view name, float value)
+{
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniform1f(uniform->location, value);
+    }
+}
+
+void UniformManager::setInt(std::string_view name, int value)
+{
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniform1i(uniform->location, value);
     }
 }
 
-void UniformManager::setLightUniform(SceneLightData &lightData, const int index)
+void UniformManager::setUInt(std::string_view name, uint32_t value)
 {
-    assert(index < 8 && index >= 0); // We only support 8 lights
-    std::string lightUniformStruct = "lights[" + std::to_string(index) + "]";
-    std::string lightType = lightUniformStruct + ".type";
-    setBool((lightUniformStruct + ".enabled").c_str(), true);
-    switch(lightData.type)
-    {
-        case LightType::LIGHT_DIRECTIONAL:
-            setInt(lightType.c_str(), 0);
-            break;
-        case LightType::LIGHT_POINT:
-            setInt(lightType.c_str(), 1);
-            break;
-        case LightType::LIGHT_SPOT:
-            setInt(lightType.c_str(), 2);
-            break;
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniform1ui(uniform->location, value);
     }
-    setVec4((lightUniformStruct + ".color").c_str(), lightData.color);
-    setVec3((lightUniformStruct + ".function").c_str(), lightData.function);
-    setVec4((lightUniformStruct + ".pos").c_str(), lightData.pos);
-    setVec4((lightUniformStruct + ".dir").c_str(), lightData.dir);
-    setFloat((lightUniformStruct + ".penumbra").c_str(), lightData.penumbra);
-    setFloat((lightUniformStruct + ".angle").c_str(), lightData.angle);
 }
 
-void UniformManager::setMaterialUniform(const SceneMaterial &material)
+void UniformManager::setVec2(std::string_view name, const glm::vec2& value)
 {
-    setVec4("material.cAmbient", material.cAmbient);
-    setVec4("material.cDiffuse", material.cDiffuse);
-    setVec4("material.cSpecular", material.cSpecular);
-    setFloat("material.shininess", material.shininess);
-    setFloat("material.blend", material.blend);
-
-    setBool("filemap.isUsed", material.textureMap.isUsed);
-    setFloat("filemap.repeatU", material.textureMap.repeatU);
-    setFloat("filemap.repeatV", material.textureMap.repeatV);
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniform2fv(uniform->location, 1, &value[0]);
+    }
 }
 
+void UniformManager::setVec3(std::string_view name, const glm::vec3& value)
+{
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniform3fv(uniform->location, 1, &value[0]);
+    }
+}
 
-void UniformManager::setTextureUniform(GLuint slot)
+void UniformManager::setVec4(std::string_view name, const glm::vec4& value)
 {
-    setInt("textureSampler", slot);
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniform4fv(uniform->location, 1, &value[0]);
+    }
 }
 
-void UniformManager::setTextImageUniform(GLuint slot)
+void UniformManager::setMat3(std::string_view name, const glm::mat3& value)
 {
-    setInt("textImgSampler", slot);
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniformMatrix3fv(uniform->location, 1, GL_FALSE, &value[0][0]);
+    }
 }
 
-void UniformManager::setPostProcessUniforms(bool usePixelFilter, bool useBlurFilter, bool useFXAA, bool useGrayscale)
+void UniformManager::setMat4(std::string_view name, const glm::mat4& value)
 {
-    setBool("usePixelFilter", usePixelFilter);
-    setBool("useBlurFilter", useBlurFilter);
-    setBool("useFXAAFilter", useFXAA);
-    setBool("useGrayscaleFilter", useGrayscale);
-}
\ No newline at end of file
+    if (Uniform* uniform = prepare(name, &value, sizeof(value))) {
+        glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &value[0][0]);
+    }
+}
@@ -4,66 +4,78 @@
 #include <glm/glm.hpp>
 #include <unordered_map>
 #include <string>
-#include "utils/sceneparser.h"
+#include <string_view>
+#include <vector>
+#include <cstdint>
 
+// Uniform front end for every program the renderer draws with. Each program's active
+// uniforms are resolved once when it is registered, and the last value written to each
+// location is shadowed so redundant glUniform* calls are skipped.
 class UniformManager {
-private:
-    // std::unordered_map<std::string, GLint> m_uniformLocations;
-    GLuint m_shader;
-
 public:
-    UniformManager(GLuint shaderProgram) : m_shader(shaderProgram) {}
-
-    void setShader(GLuint shaderProgram) {
-        m_shader = shaderProgram;
-        glUseProgram(m_shader);
-    }
+    // Mirrors the std140 FrameData block that every shader declares; written once per frame
+    struct FrameData {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::vec4 cameraPosition;  // w unused
+        glm::vec4 sunDirection;    // Unit vector towards the sun, w unused
+        float brightness;
+        float time;
+        float padding[2];          // std140 rounds the block up to 16 bytes
+    };
+    static constexpr const char* FRAME_BLOCK = "FrameData";
+    static constexpr GLuint FRAME_BLOCK_BINDING = 0;
 
-    // Cache uniform locations
-    GLuint getUniformLocation(const char* name);
+    // Resolves all active uniforms of a freshly linked program; calling it again is a no-op
+    void registerProgram(GLuint program);
+    // Forgets a program before it is deleted
+    void releaseProgram(GLuint program);
 
-    // Type-safe uniform setters
-    void setFloat(const char* name, float value) {
-        glUniform1f(getUniformLocation(name), value);
-    }
+    // Uploads the frame block and binds it for all registered programs
+    void setFrameData(const FrameData& frame);
+    // Deletes the frame buffer; needs the owning context to be current
+    void releaseFrameBuffer();
 
-    void setVec3(const char* name, const glm::vec3& value) {
-        glUniform3fv(getUniformLocation(name), 1, &value[0]);
-    }
+    // Binds the program and makes it the target of the setters (registering it if needed)
+    void use(GLuint program);
 
-    void setVec4(const char* name, const glm::vec4& value) {
-        glUniform4fv(getUniformLocation(name), 1, &value[0]);
-    }
+    // -1 if the current program has no active uniform with this name
+    GLint getUniformLocation(std::string_view name) const;
 
-    void setMat4(const char* name, const glm::mat4& value) {
-        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &value[0][0]);
-    }
+    // Type-safe uniform setters; names the current program does not use are ignored
+    void setFloat(std::string_view name, float value);
+    void setInt(std::string_view name, int value);
+    void setUInt(std::string_view name, uint32_t value);
+    void setBool(std::string_view name, bool value) { setInt(name, value); }
+    void setVec2(std::string_view name, const glm::vec2& value);
+    void setVec3(std::string_view name, const glm::vec3& value);
+    void setVec4(std::string_view name, const glm::vec4& value);
+    void setMat3(std::string_view name, const glm::mat3& value);
+    void setMat4(std::string_view name, const glm::mat4& value);
 
-    void setInt(const char* name, int value) {
-        glUniform1i(getUniformLocation(name), value);
-    }
-    
-    void setBool(const char* name, bool value) {
-        glUniform1i(getUniformLocation(name), value);
-    }
-
-    // Actual uniform setters
-    void setSceneGlobalUniform(SceneGlobalData& globalData);
+private:
+    // Lets the location table be searched with a string_view, no std::string per lookup
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
 
-    void setMVPUniform(const glm::mat4 &projectionMatrix, const glm::mat4& viewMatrix, const glm::mat4 &ctm);
-    
-    void setLightUniform(SceneLightData& lightData, const int index);
-    
-    void setMaterialUniform(const SceneMaterial& material);
+    struct Uniform {
+        GLint location;
+        uint8_t value[64];  // Last value written; large enough for a mat4
+        bool hasValue = false;
+    };
 
-    void setCameraPosUniform(const glm::vec4& cameraPos) {
-        setVec4("camPos", cameraPos);
-    }
-    
-    void setTextureUniform(GLuint slot=0);
+    struct Program {
+        std::unordered_map<std::string, size_t, NameHash, std::equal_to<>> indices;
+        std::vector<Uniform> uniforms;
+    };
 
-    void setPostProcessUniforms(bool usePixelFilter, bool useBlurFilter, bool useFXAA, bool useGrayscale);
-    void clearUniforms();
+    // Returns the uniform to write, or nullptr if it is inactive or already holds the value
+    Uniform* prepare(std::string_view name, const void* value, size_t size);
 
-    void setTextImageUniform(GLuint slot);
+    std::unordered_map<GLuint, Program> m_programs;
+    Program* m_current = nullptr;
+    GLuint m_frameUbo = 0;
 };
@@ -1,87 +1,227 @@
 #include "particle.h"
 #include <random>
 #include <ctime>
+#include <cmath>
+#include <algorithm>
+#include "glm/glm.hpp"
+#include "heightGrid.h"
+
+const float ParticleSystem::GROUND_LEVEL = -20.0f;
+const float ParticleSystem::SPAWN_HEIGHT = 100.0f;
 
 ParticleSystem::ParticleSystem(int maxParticles)
     : emissionAreaWidth(200.0f)
     , emissionAreaHeight(200.0f)
     , particleSpeed(25.0f)
     , windDirection(0.0f, 0.0f, 0.0f)
+    , anchor(0.0f, 0.0f, 0.0f)
+    , viewDirection(0.0f, 0.0f, 0.0f)
     , isSnow(true)
     , rng(std::random_device{}()) {
     particles.resize(maxParticles);
-    for (auto& particle : particles) {
-        resetParticle(particle, true);
-    }
+    activeCount = particles.size();
+    reset();
 }
 
 ParticleSystem::~ParticleSystem() {
     // Vector will clean up automatically
 }
 
-float ParticleSystem::randomFloat(float min, float max) {
-    std::uniform_real_distribution<float> dist(min, max);
-    return dist(rng);
+void ParticleSystem::resetParticle(Particle& particle, bool randomizeHeight) {
+    float uniforms[RESPAWN_UNIFORMS];
+    rng.fillUniform(uniforms, RESPAWN_UNIFORMS);
+    resetParticle(particle, uniforms, randomizeHeight);
 }
 
-void ParticleSystem::resetParticle(Particle& particle, bool randomizeHeight) {
-    float x = randomFloat(-emissionAreaWidth/2, emissionAreaWidth/2);
-    float z = randomFloat(-emissionAreaHeight/2, emissionAreaHeight/2);
+// Respawns from pre-generated uniforms in [0, 1): x, y, z, vx, vz, life, view bias
+void ParticleSystem::resetParticle(Particle& particle, const float* u, bool randomizeHeight) {
+    auto range = [](float t, float min, float max) { return min + (max - min) * t; };
+
+    float offsetX = range(u[0], -emissionAreaWidth/2, emissionAreaWidth/2);
+    float offsetZ = range(u[2], -emissionAreaHeight/2, emissionAreaHeight/2);
+    float along = offsetX * viewDirection.x + offsetZ * viewDirection.z;
+    if (along < 0.0f && u[6] < EMISSION_VIEW_BIAS) {
+        // Mirror across the plane through the camera, keeping the spawn in the volume
+        offsetX -= 2.0f * along * viewDirection.x;
+        offsetZ -= 2.0f * along * viewDirection.z;
+    }
+    particle.position = glm::vec3(anchor.x + offsetX, 0.0f, anchor.z + offsetZ);
+    wrapToVolume(particle);
+    float x = particle.position.x;
+    float z = particle.position.z;
+    // With terrain the column starts at the ground, so no particle spawns inside a hill
+    float base = ground ? groundHeight(x, z) : 0.0f;
     float y = randomizeHeight ?
-                  randomFloat(0.0f, 100.0f) :
-                  100.0f;
-    particle.position = QVector3D(x, y, z);
+                  base + range(u[1], 0.0f, SPAWN_HEIGHT) :
+                  base + SPAWN_HEIGHT;
+    particle.position = glm::vec3(x, y, z);
 
     if (isSnow) {
         // Snow parameters remain unchanged
-        particle.velocity = QVector3D(
-            randomFloat(-0.5f, 0.5f),
+        particle.velocity = glm::vec3(
+            range(u[3], -0.5f, 0.5f),
             -particleSpeed * 0.15f,
-            randomFloat(-0.5f, 0.5f)
+            range(u[4], -0.5f, 0.5f)
             );
         particle.size = 0.3f;
         particle.life = 1.0f;
     } else {
         // Modified rain parameters for lighter appearance
-        particle.velocity = QVector3D(
-            randomFloat(-0.1f, 0.1f),          // Reduced horizontal spread
+        particle.velocity = glm::vec3(
+            range(u[3], -0.1f, 0.1f),          // Reduced horizontal spread
             -particleSpeed * 2.0f,             // Slightly reduced speed
-            randomFloat(-0.1f, 0.1f)           // Reduced horizontal spread
+            range(u[4], -0.1f, 0.1f)           // Reduced horizontal spread
             );
         particle.size = 0.08f;                 // Smaller raindrops
-        particle.life = randomFloat(0.7f, 1.0f); // Varied life for more natural look
+        particle.life = range(u[5], 0.7f, 1.0f); // Varied life for more natural look
     }
     particle.active = true;
 }
 
+// Draws the random values for every pending respawn in one pass, then applies them
+void ParticleSystem::respawnPending() {
+    if (respawnIndices.empty()) return;
+
+    respawnUniforms.resize(respawnIndices.size() * RESPAWN_UNIFORMS);
+    rng.fillUniform(respawnUniforms.data(), respawnUniforms.size());
+    for (size_t i = 0; i < respawnIndices.size(); i++) {
+        resetParticle(particles[respawnIndices[i]], &respawnUniforms[i * RESPAWN_UNIFORMS], true);
+    }
+    respawnIndices.clear();
+}
+
+// Toroidal wrap: a particle leaving one side of the volume re-enters on the other,
+// so the volume follows the anchor without respawning anything
+void ParticleSystem::wrapToVolume(Particle& particle) const {
+    auto wrap = [](float offset, float size) {
+        return offset - size * std::floor(offset / size + 0.5f);
+    };
+    float x = anchor.x + wrap(particle.position.x - anchor.x, emissionAreaWidth);
+    float z = anchor.z + wrap(particle.position.z - anchor.z, emissionAreaHeight);
+    particle.position = glm::vec3(x, particle.position.y, z);
+}
+
+float ParticleSystem::groundHeight(float x, float z) const {
+    return ground && ground->isValid() ? ground->sample(x, z) : GROUND_LEVEL;
+}
+
+void ParticleSystem::setViewDirection(const glm::vec3& forward) {
+    glm::vec3 horizontal(forward.x, 0.0f, forward.z);
+    float length = glm::length(horizontal);
+    viewDirection = length > 1e-4f ? horizontal / length : glm::vec3(0.0f, 0.0f, 0.0f);
+}
+
+void ParticleSystem::seed(uint64_t value) {
+    rng.seed(value);
+}
+
+void ParticleSystem::setParticleType(bool isSnow) {
+    if (activeCount == 0) {
+        // Nothing visible to fade out, switch right away
+        this->isSnow = isSnow;
+        typeChangePending = false;
+        return;
+    }
+    pendingIsSnow = isSnow;
+    typeChangePending = isSnow != this->isSnow;
+}
+
+void ParticleSystem::setIntensity(float value, bool ramp) {
+    targetIntensity = std::clamp(value, 0.0f, 1.0f);
+    if (!ramp) {
+        intensity = targetIntensity;
+        resizeActive(static_cast<size_t>(std::lround(intensity * particles.size())));
+        respawnPending();
+    }
+}
+
+size_t ParticleSystem::advanceIntensity(float deltaTime) {
+    // A pending type change ramps to zero first, then back up to the target
+    float goal = typeChangePending ? 0.0f : targetIntensity;
+    float step = INTENSITY_RAMP_RATE * deltaTime;
+    intensity = intensity < goal ? std::min(intensity + step, goal) : std::max(intensity - step, goal);
+
+    size_t previous = activeCount;
+    resizeActive(static_cast<size_t>(std::lround(intensity * particles.size())));
+    if (typeChangePending && activeCount == 0) {
+        isSnow = pendingIsSnow;
+        typeChangePending = false;
+    }
+    respawnPending();
+    return previous;
+}
+
+// Keeps active particles compacted in [0, count)
+void ParticleSystem::resizeActive(size_t count) {
+    for (size_t i = count; i < activeCount; i++) {
+        particles[i].active = false;
+    }
+    for (size_t i = activeCount; i < count; i++) {
+        respawnIndices.push_back(static_cast<uint32_t>(i));
+    }
+    activeCount = count;
+}
+
 void ParticleSystem::update(float deltaTime) {
-    const float GROUND_LEVEL = -20.0f;
-    for (auto& particle : particles) {
+    advanceIntensity(deltaTime);
+    groundHits.clear();
+    for (uint32_t i = 0; i < activeCount; i++) {
+        Particle& particle = particles[i];
         if (!particle.active) {
             resetParticle(particle);
             continue;
         }
 
         if (isSnow) {
-            float swayX = std::sin(particle.position.y() * 0.05f + particle.life * 2.0f) * 0.3f;
-            float swayZ = std::cos(particle.position.y() * 0.05f + particle.life * 2.0f) * 0.3f;
+            float swayX = std::sin(particle.position.y * 0.05f + particle.life * 2.0f) * 0.3f;
+            float swayZ = std::cos(particle.position.y * 0.05f + particle.life * 2.0f) * 0.3f;
             particle.velocity += windDirection * (deltaTime * 0.5f);
             particle.position += particle.velocity * deltaTime;
-            particle.position += QVector3D(swayX, 0, swayZ) * deltaTime;
+            particle.position += glm::vec3(swayX, 0, swayZ) * deltaTime;
+            wrapToVolume(particle);
 
-            if (particle.position.y() < GROUND_LEVEL) {
-                resetParticle(particle, true); // Always randomize height when resetting
+            if (particle.position.y < groundHeight(particle.position.x, particle.position.z)) {
+                groundHits.push_back(particle.position);
+                respawnIndices.push_back(i); // Always randomize height when resetting
             }
 
         } else {
             particle.position += particle.velocity * deltaTime;
+            wrapToVolume(particle);
 
-            if (particle.position.y() < GROUND_LEVEL) {
-                resetParticle(particle, true); // Always randomize height when resetting
+            if (particle.position.y < groundHeight(particle.position.x, particle.position.z)) {
+                groundHits.push_back(particle.position);
+                respawnIndices.push_back(i); // Always randomize height when resetting
             }
 
         }
     }
+    respawnPending();
+}
+
+float ParticleSystem::lodKeepFraction(float distance) {
+    float t = std::clamp((distance - LOD_NEAR) / (LOD_FAR - LOD_NEAR), 0.0f, 1.0f);
+    return 1.0f - t * (1.0f - LOD_MIN_KEEP);
+}
+
+size_t ParticleSystem::writeVertices(ParticleVertex* out, const glm::vec3& eye, const glm::vec3& forward) const {
+    size_t count = 0;
+    for (size_t i = 0; i < activeCount; i++) {
+        const Particle& particle = particles[i];
+        if (!particle.active) continue;
+
+        glm::vec3 toParticle = particle.position - eye;
+        if (glm::dot(toParticle, forward) < -CULL_MARGIN) continue;
+        // Each particle has a fixed rank, so the same ones drop out as distance grows
+        if (hashToFloat(static_cast<uint32_t>(i)) > lodKeepFraction(glm::length(toParticle))) continue;
+
+        ParticleVertex& v = out[count++];
+        v.position[0] = particle.position.x;
+        v.position[1] = particle.position.y;
+        v.position[2] = particle.position.z;
+        v.sizeLife = glm::packHalf2x16(glm::vec2(particle.size, particle.life));
+    }
+    return count;
 }
 
 void ParticleSystem::setEmissionArea(float width, float height) {
@@ -90,7 +230,9 @@ void ParticleSystem::setEmissionArea(float width, float height) {
 }
 
 void ParticleSystem::reset() {
-    for (auto& particle : particles) {
-        resetParticle(particle, true);
+    respawnIndices.clear();
+    for (uint32_t i = 0; i < activeCount; i++) {
+        respawnIndices.push_back(i);
     }
+    respawnPending();
 }
@@ -1,44 +1,115 @@
 #ifndef PARTICLE_H
 #define PARTICLE_H
 
-#include <QVector3D>
+#include "glm/glm.hpp"
 #include <vector>
 #include <random>
+#include <cstdint>
+#include <cstddef>
+#include "utils/random.h"
+
+class HeightGrid;
 
 struct Particle {
-    QVector3D position;
-    QVector3D velocity;
+    glm::vec3 position;
+    glm::vec3 velocity;
     float life;
     float size;
     bool active;
 };
 
+// Render-only vertex streamed to the GPU each tick: what particle.vert reads, nothing else.
+// Size and life are packed as two halfs so a vertex is 16 bytes.
+struct ParticleVertex {
+    float position[3];
+    uint32_t sizeLife;
+};
+static_assert(sizeof(ParticleVertex) == 16, "ParticleVertex must stay tightly packed");
+
 class ParticleSystem {
 public:
+    static const float GROUND_LEVEL;
+    static const float SPAWN_HEIGHT;
+    static constexpr float EMISSION_VIEW_BIAS = 0.6f;  // Chance a spawn behind the camera is mirrored in front
+    static constexpr float LOD_NEAR = 30.0f;           // Full density up to here
+    static constexpr float LOD_FAR = 100.0f;           // LOD_MIN_KEEP from here on
+    static constexpr float LOD_MIN_KEEP = 0.25f;
+    static constexpr float CULL_MARGIN = 2.0f;         // Keeps sprites straddling the eye plane
+
     ParticleSystem(int maxParticles = 10000);
     ~ParticleSystem();
 
     void update(float deltaTime);
     void reset();
     const std::vector<Particle>& getParticles() const { return particles; }
-    void setWindDirection(const QVector3D& direction) { windDirection = direction; }
+    // Writes the render stream, returns the number written. Particles behind the eye are
+    // culled and distant ones thinned out (stable per particle, so nothing flickers).
+    size_t writeVertices(ParticleVertex* out, const glm::vec3& eye, const glm::vec3& forward) const;
+    // Fraction of particles kept at a distance from the eye, shared with particle.vert
+    static float lodKeepFraction(float distance);
+    void setWindDirection(const glm::vec3& direction) { windDirection = direction; }
     void setEmissionArea(float width, float height);
-    void setParticleType(bool isSnow) {
-        this->isSnow = isSnow;
-        reset(); // Immediately reset all particles when type changes
-    }
+    // Centre of the simulated volume; particles wrap around it horizontally as it moves
+    void setAnchor(const glm::vec3& anchor) { this->anchor = anchor; }
+    // Respawns favour the half of the volume in front of this direction
+    void setViewDirection(const glm::vec3& forward);
+    const glm::vec3& getViewDirection() const { return viewDirection; }
+    // Terrain to collide against; without one particles fall to GROUND_LEVEL
+    void setGround(const HeightGrid* grid) { ground = grid; }
+    // Where particles hit the ground during the last update, for splash or settle effects
+    const std::vector<glm::vec3>& getGroundHits() const { return groundHits; }
+    // Changing type fades the current particles out before the new type fades in
+    void setParticleType(bool isSnow);
+
+    // Fraction of maxParticles that is simulated and drawn. Active particles always
+    // occupy the front of the buffer; ramp eases towards the new value over time.
+    void setIntensity(float intensity, bool ramp = true);
+    float getIntensity() const { return intensity; }
+    size_t getActiveCount() const { return activeCount; }
+    // Steps the intensity ramp (also called by update). Newly activated particles are
+    // respawned; returns the active count before the step.
+    size_t advanceIntensity(float deltaTime);
+
+    // Simulation parameters, shared with the GPU simulation path
+    bool getParticleType() const { return isSnow; }
+    const glm::vec3& getWindDirection() const { return windDirection; }
+    float getEmissionAreaWidth() const { return emissionAreaWidth; }
+    float getEmissionAreaHeight() const { return emissionAreaHeight; }
+    float getParticleSpeed() const { return particleSpeed; }
+    const glm::vec3& getAnchor() const { return anchor; }
+
+    // Reseeds the respawn generator for reproducible runs
+    void seed(uint64_t value);
 
 private:
+    static const int RESPAWN_UNIFORMS = 7;  // Random values consumed per respawn
+    static constexpr float INTENSITY_RAMP_RATE = 0.5f;  // Intensity change per second
+
     void resetParticle(Particle& particle, bool randomizeHeight = false);
-    float randomFloat(float min, float max);
+    void resetParticle(Particle& particle, const float* uniforms, bool randomizeHeight);
+    void respawnPending();
+    void wrapToVolume(Particle& particle) const;
+    float groundHeight(float x, float z) const;
+    void resizeActive(size_t count);
 
     std::vector<Particle> particles;
     float emissionAreaWidth;
     float emissionAreaHeight;
     float particleSpeed;
-    QVector3D windDirection;
+    glm::vec3 windDirection;
+    glm::vec3 anchor;
+    glm::vec3 viewDirection;  // Horizontal, unit length or zero
     bool isSnow;
-    std::mt19937 rng;
+    bool pendingIsSnow = true;
+    bool typeChangePending = false;
+    float intensity = 1.0f;
+    float targetIntensity = 1.0f;
+    size_t activeCount = 0;
+    const HeightGrid* ground = nullptr;
+    Pcg32 rng;
+    std::vector<uint32_t> respawnIndices;  // Particles that hit the ground this update
+    std::vector<float> respawnUniforms;    // Scratch for the batched respawn draw
+    std::vector<glm::vec3> groundHits;
 };
 
 #endif // PARTICLE_H
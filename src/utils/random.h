@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// PCG32 (XSH-RR): 64-bit state, 32-bit output. Much cheaper than std::mt19937 plus a
+// distribution object, and every (seed, stream) pair is an independent sequence, so
+// workers can each take their own generator via split() and stay reproducible.
+class Pcg32 {
+public:
+    explicit Pcg32(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+        this->seed(seed, stream);
+    }
+
+    void seed(uint64_t seed, uint64_t stream = 0xda3e39cb94b95bdbULL) {
+        m_state = 0;
+        m_inc = (stream << 1u) | 1u;
+        next();
+        m_state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = m_state;
+        m_state = old * 6364136223846793005ULL + m_inc;
+        uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = static_cast<uint32_t>(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+    }
+
+    // Uniform in [0, 1), using the top 24 bits so every value is exactly representable
+    float nextFloat() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    float nextFloat(float min, float max) {
+        return min + (max - min) * nextFloat();
+    }
+
+    // Fills a whole batch of uniforms in [0, 1) in one tight loop
+    void fillUniform(float* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = nextFloat();
+        }
+    }
+
+    // Derives an independent generator (new stream) from this one
+    Pcg32 split() {
+        uint64_t seed = (static_cast<uint64_t>(next()) << 32) | next();
+        uint64_t stream = (static_cast<uint64_t>(next()) << 32) | next();
+        return Pcg32(seed, stream);
+    }
+
+private:
+    uint64_t m_state;
+    uint64_t m_inc;
+};
+
+// Stateless counter-based hash (PCG output permutation). Matches pcgHash in
+// particle_update.vert, so CPU and GPU can derive the same values from an index.
+inline uint32_t pcgHash(uint32_t v) {
+    uint32_t state = v * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+inline float hashToFloat(uint32_t v) {
+    return (pcgHash(v) >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,38 @@
+#include "rendererStats.h"
+#include <iostream>
+#include <cinttypes>
+
+StatsLogger::~StatsLogger() {
+    if (m_ownsFile) fclose(m_file);
+}
+
+bool StatsLogger::open(const std::string& path, int intervalMs) {
+    if (m_ownsFile) fclose(m_file);
+    m_ownsFile = path != "-";
+    m_file = m_ownsFile ? fopen(path.c_str(), "w") : stdout;
+    if (!m_file) {
+        std::cerr << "Failed to open stats log " << path << std::endl;
+        m_ownsFile = false;
+        return false;
+    }
+    m_interval = std::chrono::milliseconds(intervalMs);
+    m_start = std::chrono::steady_clock::now();
+    m_last = m_start - m_interval;
+    fprintf(m_file, "time_ms,frame,pending_chunks,in_flight_chunks,dropped_chunks,terrain_chunks,"
+                    "water_planes,buffer_bytes,texture_bytes,draw_calls,triangles,particles\n");
+    return true;
+}
+
+void StatsLogger::log(const RendererStats& stats) {
+    if (!m_file) return;
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_last < m_interval) return;
+    m_last = now;
+
+    long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_start).count();
+    fprintf(m_file, "%lld,%" PRIu64 ",%zu,%zu,%" PRIu64 ",%zu,%zu,%zu,%zu,%u,%" PRIu64 ",%zu\n",
+            elapsed, stats.frame, stats.pendingChunks, stats.inFlightChunks, stats.droppedChunks,
+            stats.terrainChunks, stats.waterPlanes, stats.bufferBytes, stats.textureBytes,
+            stats.drawCalls, stats.triangles, stats.particles);
+    fflush(m_file);
+}
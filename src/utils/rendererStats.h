@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <chrono>
+
+// Snapshot of the renderer's workload, refreshed at the end of every frame
+struct RendererStats {
+    uint64_t frame = 0;
+
+    // Terrain generation queue
+    size_t pendingChunks = 0;
+    size_t inFlightChunks = 0;
+    uint64_t droppedChunks = 0;  // Requests refused because the queue was full, since startup
+    uint64_t chunkRequests = 0;     // Chunks requested since startup
+    uint64_t chunkRequestHash = 0;  // Order-sensitive hash of those requests, equal across replays
+
+    // Resident geometry
+    size_t terrainChunks = 0;
+    size_t waterPlanes = 0;
+
+    // GPU memory allocated by the renderer
+    size_t bufferBytes = 0;
+    size_t textureBytes = 0;
+
+    // Submitted by the last frame
+    uint32_t drawCalls = 0;
+    uint64_t triangles = 0;
+    size_t particles = 0;
+};
+
+// Appends a CSV row per interval to a file, or to stdout for the path "-"
+class StatsLogger {
+public:
+    ~StatsLogger();
+
+    bool open(const std::string& path, int intervalMs);
+    bool isOpen() const { return m_file != nullptr; }
+
+    // Writes the snapshot if the interval has elapsed since the last row
+    void log(const RendererStats& stats);
+
+private:
+    FILE* m_file = nullptr;
+    bool m_ownsFile = false;
+    std::chrono::milliseconds m_interval{1000};
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_last;
+};
@@ -316,3 +316,68 @@ std::vector<float> TerrainGenerator::generateTerrainChunk(int chunkX, int chunkZ
     }
     return verts;
 }
+
+std::vector<float> TerrainGenerator::generateWaterPlane(const glm::dvec2& position) {
+    std::vector<float> data;
+    float chunkSize = CHUNK_SIZE;
+    int verticesPerSide = static_cast<int>(chunkSize / VERTEX_SPACING);
+
+    // Pre-allocate memory for better performance
+    data.reserve(verticesPerSide * verticesPerSide * 30);
+
+    for (int x = 0; x < verticesPerSide; x++) {
+        for (int z = 0; z < verticesPerSide; z++) {
+            // Calculate exact world positions
+            float x1 = position.x + x * VERTEX_SPACING;
+            float x2 = position.x + (x + 1) * VERTEX_SPACING;
+            float z1 = position.y + z * VERTEX_SPACING;
+            float z2 = position.y + (z + 1) * VERTEX_SPACING;
+
+            // Calculate UV coordinates
+            float u1 = static_cast<float>(x) / verticesPerSide;
+            float u2 = static_cast<float>(x + 1) / verticesPerSide;
+            float v1 = static_cast<float>(z) / verticesPerSide;
+            float v2 = static_cast<float>(z + 1) / verticesPerSide;
+
+            // First triangle
+            data.push_back(x1);
+            data.push_back(0.0f);  // Water height will be set by model matrix
+            data.push_back(z1);
+            data.push_back(u1);
+            data.push_back(v1);
+
+            data.push_back(x2);
+            data.push_back(0.0f);
+            data.push_back(z1);
+            data.push_back(u2);
+            data.push_back(v1);
+
+            data.push_back(x2);
+            data.push_back(0.0f);
+            data.push_back(z2);
+            data.push_back(u2);
+            data.push_back(v2);
+
+            // Second triangle
+            data.push_back(x1);
+            data.push_back(0.0f);
+            data.push_back(z1);
+            data.push_back(u1);
+            data.push_back(v1);
+
+            data.push_back(x2);
+            data.push_back(0.0f);
+            data.push_back(z2);
+            data.push_back(u2);
+            data.push_back(v2);
+
+            data.push_back(x1);
+            data.push_back(0.0f);
+            data.push_back(z2);
+            data.push_back(u1);
+            data.push_back(v2);
+        }
+    }
+
+    return data;
+}
@@ -13,6 +13,12 @@ public:
     std::vector<float> generateTerrain();
     std::vector<float> generateTerrainChunk(int chunkX, int chunkZ);
     float getWorldHeight(float worldX, float worldZ);
+    // Flat water mesh for the chunk whose corner is at position: position, uv per vertex
+    static std::vector<float> generateWaterPlane(const glm::dvec2& position);
+
+    // Noise in normalized terrain space: a single octave, and the six-octave sum
+    float computePerlin(float x, float y);
+    float getHeight(float x, float y);
 
 private:
     // Basic terrain parameters
@@ -36,10 +42,8 @@ private:
     // Helper functions
     glm::vec2 sampleRandomVector(int row, int col);
     glm::vec3 getPosition(int row, int col);
-    float getHeight(float x, float y);
     glm::vec3 getNormal(int row, int col);
     glm::vec3 getColor(float worldX, float worldZ);
-    float computePerlin(float x, float y);
     float mapHeight(float normalizedHeight);
     glm::vec2 worldToLocal(float worldX, float worldZ);
     glm::vec2 localToWorld(float localX, float localZ, int chunkX, int chunkZ);
@@ -1,60 +1,36 @@
 #pragma once
 
-#include <queue>
-#include <mutex>
-#include <thread>
-#include <atomic>
-#include <memory>
-#include <functional>
 #include <QObject>
 
-#include "terrain.h"
+#include "chunkScheduler.h"
 
+// Qt front end of ChunkScheduler: generated chunks arrive as the chunkReady signal, which
+// a queued connection delivers on the receiver's thread
 class TerrainGenerationQueue : public QObject {
     Q_OBJECT
 
 public:
-
-    struct ChunkData {
-        int chunkX;
-        int chunkZ;
-        std::vector<float> terrainData;
-        int vertexCount;
-    };
+    using ChunkData = ChunkScheduler::ChunkData;
+    using Stats = ChunkScheduler::Stats;
 
     TerrainGenerationQueue(TerrainGenerator* terrainGenerator, QObject* parent = nullptr);
     ~TerrainGenerationQueue();
 
-    void addChunk(int chunkX, int chunkZ);
-    void shutdown();
-    bool isProcessing();
-    size_t getQueueSize();
+    bool addChunk(int chunkX, int chunkZ) { return m_scheduler.addChunk(chunkX, chunkZ); }
+    // Drops pending requests outside [minX, maxX] x [minZ, maxZ]; chunks already being
+    // generated still arrive
+    void cancelOutside(int minX, int maxX, int minZ, int maxZ) { m_scheduler.cancelOutside(minX, maxX, minZ, maxZ); }
+    void shutdown() { m_scheduler.shutdown(); }
+    bool isProcessing() { return m_scheduler.isProcessing(); }
+    size_t getQueueSize() { return m_scheduler.getQueueSize(); }
+    Stats getStats() { return m_scheduler.getStats(); }
 
 signals:
     // Signal emitted when a chunk is ready
     void chunkReady(const ChunkData& chunk);
 
 private:
-    // Worker thread function
-    void processQueue();
-
-    // Queue for pending chunk generation requests
-    std::queue<std::pair<int, int>> m_pendingChunks;
-    
-    // Mutex for thread synchronization
-    std::mutex m_mutex;
-    
-    // Worker thread
-    std::unique_ptr<std::thread> m_workerThread;
-    
-    // Flag to control worker thread
-    std::atomic<bool> m_running;
-    
-    // Reference to the terrain generator
-    TerrainGenerator* m_terrainGenerator;
-
-    // Maximum number of pending chunks in queue
-    static const size_t MAX_QUEUE_SIZE = 100;
+    ChunkScheduler m_scheduler;
 };
 
 // Optional: Helper struct for chunk prioritization
@@ -0,0 +1,199 @@
+#include "textureLoader.h"
+#include "bc1Encoder.h"
+#include <QImage>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QByteArrayView>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureLoader::TextureLoader(int maxSize, bool compress)
+    : m_maxSize(maxSize)
+    , m_compress(compress)
+{
+    m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/textures";
+    if (!QDir().mkpath(m_cacheDir)) {
+        std::cerr << "Texture cache disabled, cannot create " << m_cacheDir.toStdString() << std::endl;
+        m_cacheDir.clear();
+    }
+}
+
+std::vector<TextureData> TextureLoader::loadAll(const std::vector<QString>& paths) const {
+    std::vector<TextureData> results(paths.size());
+    const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t threadCount = std::min<size_t>(paths.size(), hardwareThreads);
+    // Textures are already spread over the workers; split the encoder only over what is left
+    const unsigned encodeThreads = std::max<unsigned>(1, hardwareThreads / std::max<size_t>(1, threadCount));
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            results[i] = load(paths[i], encodeThreads);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();  // The calling thread takes a share too
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+TextureData TextureLoader::load(const QString& path, unsigned encodeThreads) const {
+    TextureData data;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Failed to load texture: " << path.toStdString() << std::endl;
+        return data;
+    }
+    QByteArray source = file.readAll();
+
+    QString cached = cacheFile(source);
+    if (!cached.isEmpty() && readCache(cached, data)) {
+        return data;
+    }
+
+    QImage image = QImage::fromData(source);
+    if (image.isNull()) {
+        std::cerr << "Failed to decode texture: " << path.toStdString() << std::endl;
+        return data;
+    }
+    if (image.width() > m_maxSize || image.height() > m_maxSize) {
+        image = image.scaled(m_maxSize, m_maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    image = image.convertToFormat(QImage::Format_RGBA8888);
+
+    MipLevel base{image.width(), image.height(), {}};
+    base.pixels.resize(static_cast<size_t>(base.width) * base.height * 4);
+    for (int y = 0; y < base.height; y++) {
+        // QImage rows may be padded
+        std::memcpy(&base.pixels[static_cast<size_t>(y) * base.width * 4], image.constScanLine(y), base.width * 4);
+    }
+    data.levels.push_back(std::move(base));
+    buildMipChain(data.levels);
+
+    if (m_compress) {
+        // Levels are mipmapped from the uncompressed data, then encoded one by one
+        for (MipLevel& level : data.levels) {
+            level.pixels = BC1::encode(level.pixels.data(), level.width, level.height, encodeThreads);
+        }
+        data.format = TextureData::Format::BC1;
+    }
+
+    if (!cached.isEmpty()) {
+        writeCache(cached, data);
+    }
+    return data;
+}
+
+// 2x2 box filter down to 1x1; odd edges reuse their last row/column
+void TextureLoader::buildMipChain(std::vector<MipLevel>& levels) {
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const MipLevel& src = levels.back();
+        MipLevel dst{std::max(1, src.width / 2), std::max(1, src.height / 2), {}};
+        dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+
+        for (int y = 0; y < dst.height; y++) {
+            int y0 = std::min(y * 2, src.height - 1);
+            int y1 = std::min(y * 2 + 1, src.height - 1);
+            for (int x = 0; x < dst.width; x++) {
+                int x0 = std::min(x * 2, src.width - 1);
+                int x1 = std::min(x * 2 + 1, src.width - 1);
+                for (int c = 0; c < 4; c++) {
+                    int sum = src.pixels[(static_cast<size_t>(y0) * src.width + x0) * 4 + c]
+                            + src.pixels[(static_cast<size_t>(y0) * src.width + x1) * 4 + c]
+                            + src.pixels[(static_cast<size_t>(y1) * src.width + x0) * 4 + c]
+                            + src.pixels[(static_cast<size_t>(y1) * src.width + x1) * 4 + c];
+                    dst.pixels[(static_cast<size_t>(y) * dst.width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+        levels.push_back(std::move(dst));
+    }
+}
+
+// Keyed by the source bytes and everything that affects the output
+QString TextureLoader::cacheFile(const QByteArray& source) const {
+    if (m_cacheDir.isEmpty()) return QString();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(source);
+    uint32_t params[3] = {CACHE_VERSION, static_cast<uint32_t>(m_maxSize), m_compress};
+    hash.addData(QByteArrayView(reinterpret_cast<const char*>(params), sizeof(params)));
+    return m_cacheDir + "/" + QString::fromLatin1(hash.result().toHex()) + ".tex";
+}
+
+size_t TextureLoader::levelSize(TextureData::Format format, int width, int height) {
+    return format == TextureData::Format::BC1 ? BC1::encodedSize(width, height)
+                                              : static_cast<size_t>(width) * height * 4;
+}
+
+// Layout: magic, version, format, level count, then per level width, height and data
+bool TextureLoader::readCache(const QString& path, TextureData& data) const {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    auto readU32 = [&file](uint32_t& value) {
+        return file.read(reinterpret_cast<char*>(&value), sizeof(value)) == sizeof(value);
+    };
+    uint32_t magic, version, format, levelCount;
+    if (!readU32(magic) || !readU32(version) || !readU32(format) || !readU32(levelCount) ||
+        magic != CACHE_MAGIC || version != CACHE_VERSION || levelCount == 0 || levelCount > 32 ||
+        format > static_cast<uint32_t>(TextureData::Format::BC1)) {
+        return false;
+    }
+
+    std::vector<MipLevel> levels(levelCount);
+    for (MipLevel& level : levels) {
+        uint32_t width, height;
+        if (!readU32(width) || !readU32(height) || width == 0 || height == 0 ||
+            width > static_cast<uint32_t>(m_maxSize) || height > static_cast<uint32_t>(m_maxSize)) {
+            return false;
+        }
+        level.width = width;
+        level.height = height;
+        level.pixels.resize(levelSize(static_cast<TextureData::Format>(format), width, height));
+        qint64 size = static_cast<qint64>(level.pixels.size());
+        if (file.read(reinterpret_cast<char*>(level.pixels.data()), size) != size) {
+            return false;
+        }
+    }
+
+    data.format = static_cast<TextureData::Format>(format);
+    data.levels = std::move(levels);
+    data.fromCache = true;
+    return true;
+}
+
+void TextureLoader::writeCache(const QString& path, const TextureData& data) const {
+    // QSaveFile only replaces the entry on commit, so a crash never leaves a truncated file
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return;
+
+    auto writeU32 = [&file](uint32_t value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    writeU32(CACHE_MAGIC);
+    writeU32(CACHE_VERSION);
+    writeU32(static_cast<uint32_t>(data.format));
+    writeU32(static_cast<uint32_t>(data.levels.size()));
+    for (const MipLevel& level : data.levels) {
+        writeU32(level.width);
+        writeU32(level.height);
+        file.write(reinterpret_cast<const char*>(level.pixels.data()), static_cast<qint64>(level.pixels.size()));
+    }
+    if (!file.commit()) {
+        std::cerr << "Failed to write texture cache " << path.toStdString() << std::endl;
+    }
+}
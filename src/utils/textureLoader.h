@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <QString>
+
+// One level of a mip chain, in the format of the TextureData holding it
+struct MipLevel {
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+};
+
+struct TextureData {
+    enum class Format : uint32_t {
+        RGBA8,  // Tightly packed RGBA8
+        BC1     // 8 bytes per 4x4 block, opaque
+    };
+    Format format = Format::RGBA8;
+    std::vector<MipLevel> levels;  // Level 0 first; empty if the image could not be loaded
+    bool fromCache = false;
+};
+
+// Turns source images into GPU-ready mip chains off the GUI thread. Images are decoded in
+// parallel, downscaled to at most maxSize on their longer side and mipmapped on the CPU.
+// With compression on, every level is then BC1-encoded. The result is cached on disk
+// keyed by the source bytes, so later runs skip decoding and encoding.
+class TextureLoader {
+public:
+    explicit TextureLoader(int maxSize = 2048, bool compress = false);
+
+    // Loads every path on a pool of worker threads; results are in the order of paths
+    std::vector<TextureData> loadAll(const std::vector<QString>& paths) const;
+    // encodeThreads: threads for BC1 encoding, 0 uses every hardware thread
+    TextureData load(const QString& path, unsigned encodeThreads = 0) const;
+
+private:
+    static const uint32_t CACHE_MAGIC = 0x5845544e;  // "NTEX"
+    static const uint32_t CACHE_VERSION = 2;
+
+    static size_t levelSize(TextureData::Format format, int width, int height);
+
+    static void buildMipChain(std::vector<MipLevel>& levels);
+    QString cacheFile(const QByteArray& source) const;
+    bool readCache(const QString& file, TextureData& data) const;
+    void writeCache(const QString& file, const TextureData& data) const;
+
+    int m_maxSize;
+    bool m_compress;
+    QString m_cacheDir;
+};
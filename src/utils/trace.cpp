@@ -0,0 +1,164 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+namespace {
+
+struct Event {
+    const char* name;
+    int64_t timestamp;  // Nanoseconds since the trace epoch
+    double value;       // Counters only
+    char phase;         // 'B', 'E' or 'C', as in the trace format
+};
+
+// Written only by its own thread. The writer publishes each event by bumping head;
+// a reader copies the ring and then drops anything the writer may have overwritten.
+struct ThreadBuffer {
+    static const size_t CAPACITY = 1 << 16;
+    std::vector<Event> events = std::vector<Event>(CAPACITY);
+    std::atomic<uint64_t> head{0};
+    std::atomic<const char*> name{nullptr};
+    int id = 0;
+};
+
+std::atomic<bool> g_enabled{false};
+std::mutex g_registryMutex;  // Taken once per thread, and by dump()
+std::vector<std::shared_ptr<ThreadBuffer>> g_buffers;  // Outlive their threads
+std::string g_path;
+const auto g_epoch = std::chrono::steady_clock::now();
+// Kept outside the ring so naming a thread does not create one while tracing is off
+thread_local const char* t_threadName = nullptr;
+
+ThreadBuffer& threadBuffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadBuffer>();
+        created->name.store(t_threadName, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        created->id = static_cast<int>(g_buffers.size()) + 1;
+        g_buffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+void record(const char* name, char phase, double value) {
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    Event& event = buffer.events[head % ThreadBuffer::CAPACITY];
+    event.name = name;
+    event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - g_epoch).count();
+    event.value = value;
+    event.phase = phase;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void writeString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+void enable(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        g_path = path;
+    }
+    g_enabled.store(true, std::memory_order_release);
+}
+
+bool isEnabled() {
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void setThreadName(const char* name) {
+    t_threadName = name;
+    if (isEnabled()) threadBuffer().name.store(name, std::memory_order_relaxed);
+}
+
+void begin(const char* name) {
+    record(name, 'B', 0.0);
+}
+
+void end(const char* name) {
+    record(name, 'E', 0.0);
+}
+
+void counter(const char* name, double value) {
+    record(name, 'C', value);
+}
+
+bool dump() {
+    if (!isEnabled()) return false;
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    std::ofstream out(g_path);
+    if (!out) {
+        std::cerr << "Failed to write trace " << g_path << std::endl;
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() -> std::ostream& {
+        if (!first) out << ",\n";
+        first = false;
+        return out;
+    };
+
+    std::vector<Event> events;
+    for (const auto& buffer : g_buffers) {
+        if (const char* name = buffer->name.load(std::memory_order_relaxed)) {
+            separator() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->id
+                        << ",\"args\":{\"name\":";
+            writeString(out, name);
+            out << "}}";
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t oldest = head > ThreadBuffer::CAPACITY ? head - ThreadBuffer::CAPACITY : 0;
+        events.clear();
+        for (uint64_t i = oldest; i < head; i++) {
+            events.push_back(buffer->events[i % ThreadBuffer::CAPACITY]);
+        }
+        // Slots the writer reached while we were copying, including the one it may be
+        // writing right now, no longer hold what we read
+        uint64_t after = buffer->head.load(std::memory_order_acquire) + 1;
+        uint64_t safe = after > ThreadBuffer::CAPACITY ? after - ThreadBuffer::CAPACITY : 0;
+        size_t skip = safe > oldest ? static_cast<size_t>(std::min<uint64_t>(safe - oldest, events.size())) : 0;
+
+        for (size_t i = skip; i < events.size(); i++) {
+            const Event& event = events[i];
+            char timestamp[32];
+            snprintf(timestamp, sizeof(timestamp), "%.3f", event.timestamp / 1000.0);  // Microseconds
+            separator() << "{\"ph\":\"" << event.phase << "\",\"name\":";
+            writeString(out, event.name);
+            out << ",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << timestamp;
+            if (event.phase == 'C') {
+                out << ",\"args\":{\"value\":" << event.value << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write trace " << g_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace Trace
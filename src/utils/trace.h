@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Timeline tracing in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+// Every thread records into its own fixed-size ring, so recording takes no lock and
+// never allocates; once a ring is full its oldest events are overwritten. Names must be
+// string literals or otherwise outlive the trace, only the pointer is stored.
+namespace Trace {
+
+// Starts recording; dump() writes to path. Nothing is recorded until this is called.
+void enable(const std::string& path);
+bool isEnabled();
+
+// Label for the calling thread in the trace viewer
+void setThreadName(const char* name);
+
+void begin(const char* name);
+void end(const char* name);
+void counter(const char* name, double value);
+
+// Writes the events currently held by every thread's ring. Safe to call while other
+// threads keep recording; events overwritten during the dump are left out.
+bool dump();
+
+class Scope {
+public:
+    explicit Scope(const char* name) : m_name(isEnabled() ? name : nullptr) {
+        if (m_name) begin(m_name);
+    }
+    ~Scope() {
+        if (m_name) end(m_name);
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* m_name;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Records the enclosing block as one slice
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_COUNTER(name, value) do { if (Trace::isEnabled()) Trace::counter(name, value); } while (0)
@@ -0,0 +1,158 @@
+#include "uploadThread.h"
+#include "trace.h"
+#include <iostream>
+
+UploadThread::~UploadThread() {
+    // The render context is gone by now, so finished jobs can only be abandoned
+    if (m_thread) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_jobs.clear();
+        }
+        m_wake.notify_all();
+        m_thread->wait();
+    }
+}
+
+bool UploadThread::start(QOpenGLContext* shareContext) {
+    if (m_thread || !shareContext) return false;
+
+    m_surface = std::make_unique<QOffscreenSurface>();
+    m_surface->setFormat(shareContext->format());
+    m_surface->create();
+    m_context = std::make_unique<QOpenGLContext>();
+    m_context->setFormat(shareContext->format());
+    m_context->setShareContext(shareContext);
+    if (!m_surface->isValid() || !m_context->create()) {
+        std::cerr << "Failed to create a shared upload context, uploading on the render thread" << std::endl;
+        m_context.reset();
+        m_surface.reset();
+        return false;
+    }
+
+    // The context has to live on the thread that makes it current
+    m_ownerThread = QThread::currentThread();
+    m_thread.reset(QThread::create([this]() { run(); }));
+    m_context->moveToThread(m_thread.get());
+    m_thread->start();
+    return true;
+}
+
+void UploadThread::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_jobs.clear();
+    }
+    if (!m_thread) return;
+    m_wake.notify_all();
+    m_thread->wait();
+    // Jobs that ran may own objects only their completions hand over
+    finish();
+    m_thread.reset();
+    m_context.reset();
+    m_surface.reset();
+}
+
+void UploadThread::submit(Job job, Completion completion) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop) return;
+        m_jobs.emplace_back(std::move(job), std::move(completion));
+        TRACE_COUNTER("Pending uploads", m_jobs.size());
+    }
+    m_wake.notify_one();
+}
+
+size_t UploadThread::collect() {
+    size_t completed = 0;
+    if (!m_thread) {
+        std::deque<std::pair<Job, Completion>> jobs;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            jobs.swap(m_jobs);
+        }
+        for (auto& job : jobs) {
+            job.first();
+            job.second();
+            completed++;
+        }
+        return completed;
+    }
+    while (true) {
+        Finished finished;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_done.empty()) break;
+            // Fences from one context signal in order, so the first unsignalled one ends the scan
+            GLenum status = glClientWaitSync(m_done.front().fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+            finished = std::move(m_done.front());
+            m_done.pop_front();
+        }
+        glDeleteSync(finished.fence);
+        finished.completion();
+        completed++;
+    }
+    return completed;
+}
+
+void UploadThread::finish() {
+    if (!m_thread) {
+        collect();
+        return;
+    }
+    while (true) {
+        GLsync fence = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_finished.wait(lock, [this]() {
+                return !m_done.empty() || (m_jobs.empty() && m_running == 0) || m_stop;
+            });
+            if (m_done.empty()) return;
+            fence = m_done.front().fence;
+        }
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        collect();
+    }
+}
+
+size_t UploadThread::getPending() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.size() + m_running + m_done.size();
+}
+
+void UploadThread::run() {
+    Trace::setThreadName("Upload");
+    m_context->makeCurrent(m_surface.get());
+    while (true) {
+        std::pair<Job, Completion> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_stop) break;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_running++;
+        }
+
+        {
+            TRACE_SCOPE("Upload");
+            job.first();
+        }
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // Another context can only see the fence signal once it has been submitted
+        glFlush();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.push_back(Finished{fence, std::move(job.second)});
+            m_running--;
+        }
+        m_finished.notify_all();
+    }
+    m_context->doneCurrent();
+    // Hand the context back so it is destroyed on the thread that created it
+    m_context->moveToThread(m_ownerThread);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "GL/glew.h"
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Creates buffers and textures on a worker thread with its own context, shared with the
+// renderer's. After each job the worker inserts a fence; the render thread polls the
+// fences and only takes over a job's GL objects once the GPU has them, so streaming never
+// blocks a frame. Objects that are not shared between contexts (VAOs, FBOs) still have
+// to be made by the completion callback on the render thread.
+class UploadThread {
+public:
+    // Runs on the worker with the upload context current
+    using Job = std::function<void()>;
+    // Runs on the render thread once the job's GL commands have completed
+    using Completion = std::function<void()>;
+
+    ~UploadThread();
+
+    // Starts the worker with a context sharing objects with shareContext. Must be called on
+    // the GUI thread. Without a worker, jobs wait for collect() and run there instead.
+    bool start(QOpenGLContext* shareContext);
+    // Drops jobs that have not started and completes the rest; needs the render context current
+    void shutdown();
+
+    void submit(Job job, Completion completion);
+    // Runs the completions of every job whose fence has signalled, in submission order;
+    // needs the render context current. Returns how many completed.
+    size_t collect();
+    // Waits until every submitted job has completed
+    void finish();
+
+    size_t getPending();  // Submitted and not yet collected
+
+private:
+    struct Finished {
+        GLsync fence;
+        Completion completion;
+    };
+
+    void run();
+
+    std::unique_ptr<QOffscreenSurface> m_surface;
+    std::unique_ptr<QOpenGLContext> m_context;
+    std::unique_ptr<QThread> m_thread;
+    QThread* m_ownerThread = nullptr;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;      // Work or stop for the worker
+    std::condition_variable m_finished;  // A job finished, for finish()
+    std::deque<std::pair<Job, Completion>> m_jobs;
+    std::deque<Finished> m_done;
+    size_t m_running = 0;  // Jobs taken by the worker and not yet in m_done
+    bool m_stop = false;
+};